@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bignum.h"
+
+/*
+ * Benchmark of the public operations over operand sizes.
+ *
+ * Usage: bench [-m max_limbs] [-b baseline]
+ *
+ * Every operation is timed on operands of 1 to max_limbs (default 10^6)
+ * bignum digits, repeating it until MIN_TIME has passed. An operation
+ * is no longer timed at larger sizes once a single call takes more
+ * than MAX_TIME. Output has one line per operation and size:
+ *
+ *	op limbs reps ns_per_op limbs_per_sec [baseline_ns_per_op speedup]
+ *
+ * the last two columns when the baseline, an earlier output of bench,
+ * has the same operation and size. Lines starting with '#' are comments.
+ * long_div divides an operand of twice the size, so that the quotient
+ * has the size too.
+ */
+
+// decimal digits in a bignum digit, as in bignum.c
+#if defined(DEBUG)
+#define LIMB_DIGITS 1
+#elif defined(WIDE_DIGITS)
+#define LIMB_DIGITS 18
+#else
+#define LIMB_DIGITS 9
+#endif
+
+#define MIN_TIME 0.2
+#define MAX_TIME 5.0
+#define DEFAULT_MAX_LIMBS 1000000
+
+enum { B_PARSE, B_FORMAT, B_ADD, B_SUB, B_MUL, B_DIV, B_SQRT, B_POW, B_NONE };
+static const char *const B_NAMES[] = {
+	"string_to_bignum", "bignum_to_string", "add", "sub", "long_mul", "long_div",
+	"sqrt_signed", "long_pow"
+};
+
+// exponent of the long_pow benchmark
+#define POW_EXP "3"
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Return a malloc'd string of `digits' random decimal digits,
+ * without leading zero.
+ */
+static char *random_digits(size_t digits) {
+	char *s = malloc(digits + 1);
+	if (!s) exit(EXIT_FAILURE);
+	for (size_t i = 0; i < digits; ++i) s[i] = '0' + rand() % 10;
+	s[0] = '1' + rand() % 9;
+	s[digits] = '\0';
+	return s;
+}
+
+/*
+ * Operands of one size.
+ */
+struct operands {
+	char *sa;
+	struct bignum *a, *b, *e;
+	struct bignum *d; // dividend of twice the size, for a quotient of the size
+};
+
+/*
+ * Run operation `op' once on `o'.
+ */
+static void run(int op, const struct operands *o) {
+	struct bignum *r = NULL;
+	char *s;
+	switch (op) {
+	case B_PARSE:
+		r = string_to_bignum(o->sa);
+		break;
+	case B_FORMAT:
+		s = bignum_to_string(o->a);
+		free(s);
+		break;
+	case B_ADD:
+		r = addsub_signed(o->a, o->b, 0);
+		break;
+	case B_SUB:
+		r = addsub_signed(o->a, o->b, 1);
+		break;
+	case B_MUL:
+		r = long_mul(o->a, o->b);
+		break;
+	case B_DIV:
+		r = long_div(o->d, o->b);
+		break;
+	case B_SQRT:
+		r = sqrt_signed(o->a);
+		break;
+	case B_POW:
+		r = long_pow(o->a, o->e);
+		break;
+	}
+	if (r) bignum_free(r);
+}
+
+/*
+ * Time operation `op' on `o'. Return ns per call, and the number of
+ * calls in reps.
+ */
+static double measure(int op, const struct operands *o, long *reps) {
+	long n = 1;
+	for (;;) {
+		double start = now();
+		for (long i = 0; i < n; ++i) run(op, o);
+		double t = now() - start;
+		if (t >= MIN_TIME || t / n > MAX_TIME) {
+			*reps = n;
+			return t / n * 1e9;
+		}
+		// aim a little past MIN_TIME from what this took
+		long next = t > 0 ? (long)(n * MIN_TIME * 1.2 / t) : 10 * n;
+		n = next > 2 * n ? (next < 100 * n ? next : 100 * n) : 2 * n;
+	}
+}
+
+/*
+ * A line of the baseline.
+ */
+struct entry {
+	int op;
+	long limbs;
+	double ns;
+};
+
+/*
+ * Read the baseline at `path' into a malloc'd array, its length in n.
+ * Return NULL if it cannot be opened.
+ */
+static struct entry *read_baseline(const char *path, int *n) {
+	FILE *f = fopen(path, "r");
+	if (!f) return NULL;
+	struct entry *e = NULL;
+	int cap = 0;
+	*n = 0;
+	char line[256], name[64];
+	while (fgets(line, sizeof line, f)) {
+		long limbs, reps;
+		double ns;
+		if (line[0] == '#' || sscanf(line, "%63s %ld %ld %lf", name, &limbs, &reps, &ns) != 4) continue;
+		int op = 0;
+		while (op < B_NONE && strcmp(name, B_NAMES[op])) ++op;
+		if (op == B_NONE) continue;
+		if (*n == cap) {
+			cap = cap ? 2 * cap : 64;
+			e = realloc(e, cap * sizeof(struct entry));
+			if (!e) exit(EXIT_FAILURE);
+		}
+		struct entry x = {op, limbs, ns};
+		e[(*n)++] = x;
+	}
+	fclose(f);
+	return e;
+}
+
+static const struct entry *find(const struct entry *e, int n, int op, long limbs) {
+	for (int i = 0; i < n; ++i) {
+		if (e[i].op == op && e[i].limbs == limbs) return &e[i];
+	}
+	return NULL;
+}
+
+int main(int argc, char **argv) {
+	long max_limbs = DEFAULT_MAX_LIMBS;
+	const char *baseline_path = NULL;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+			max_limbs = atol(argv[++i]);
+		} else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+			baseline_path = argv[++i];
+		} else {
+			fprintf(stderr, "usage: %s [-m max_limbs] [-b baseline]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	int nbase = 0;
+	struct entry *base = baseline_path ? read_baseline(baseline_path, &nbase) : NULL;
+	if (baseline_path && !base) fprintf(stderr, "%s: no baseline, not compared\n", baseline_path);
+
+	srand(1);
+	printf("# op limbs reps ns_per_op limbs_per_sec [baseline_ns_per_op speedup]\n");
+	printf("# %d decimal digits per limb, precision %d, long_pow exponent %s\n",
+			LIMB_DIGITS, bignum_get_precision(), POW_EXP);
+	int slow[B_NONE] = {0}; // no longer timed
+	// sizes 1, 3, 10, 30, ...
+	for (long limbs = 1; limbs <= max_limbs; limbs = limbs % 3 ? limbs * 3 : limbs / 3 * 10) {
+		struct operands o;
+		char *sb = random_digits(limbs * LIMB_DIGITS);
+		char *sd = random_digits(2 * limbs * LIMB_DIGITS);
+		o.sa = random_digits(limbs * LIMB_DIGITS);
+		o.a = string_to_bignum(o.sa);
+		o.b = string_to_bignum(sb);
+		o.e = string_to_bignum(POW_EXP);
+		o.d = string_to_bignum(sd);
+		free(sb);
+		free(sd);
+		for (int op = 0; op < B_NONE; ++op) {
+			if (slow[op]) continue;
+			long reps;
+			double ns = measure(op, &o, &reps);
+			if (ns > MAX_TIME * 1e9) slow[op] = 1;
+			printf("%s %ld %ld %.1f %.4g", B_NAMES[op], limbs, reps, ns, limbs / ns * 1e9);
+			const struct entry *e = find(base, nbase, op, limbs);
+			if (e) printf(" %.1f %.3f", e->ns, e->ns / ns);
+			putchar('\n');
+			fflush(stdout);
+		}
+		free(o.sa);
+		bignum_free(o.a);
+		bignum_free(o.b);
+		bignum_free(o.e);
+		bignum_free(o.d);
+	}
+	free(base);
+	return 0;
+}
@@ -4,18 +4,30 @@
  * January, 2020
  */
 
+#include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "bignum.h"
 
+/*
+ * Build with -DWIDE_DIGITS for 64 bit digits of radix 1e18, with 128 bit
+ * intermediate products. Half as many digits, a quarter as many digit
+ * products. Needs unsigned __int128 (gcc, clang on 64 bit targets).
+ * Debug builds always use the small radix.
+ */
 #ifdef DEBUG
-#include <stdio.h>
+#undef WIDE_DIGITS
 #endif
 
-#include "bignum.h"
-
-/* Radix for bignum representation = 1e9 */
+/* Radix for bignum representation = 1e9 (1e18 for wide digits) */
 #ifdef DEBUG
 #define RADIX 10
+#elif defined(WIDE_DIGITS)
+#define RADIX 1000000000000000000ULL
 #else
 #define RADIX 1000000000
 #endif
@@ -23,6 +35,8 @@
 /* Number of decimal digits per bignum digit */
 #ifdef DEBUG
 #define RNUM 1
+#elif defined(WIDE_DIGITS)
+#define RNUM 18
 #else
 #define RNUM 9
 #endif
@@ -31,702 +45,3617 @@
  * Ensure digit_t is at least 32 bits.
  * `unsigned' is not strictly portable here,
  * but will work on most modern machines.
+ * lldigit_t holds the product of two digits.
  */
+#ifdef WIDE_DIGITS
+typedef unsigned long long digit_t;
+__extension__ typedef unsigned __int128 lldigit_t;
+#else
 typedef unsigned digit_t;
+typedef unsigned long long lldigit_t;
+#endif
+
+/*
+ * Vector kernels for x86-64 (gcc, clang), chosen at runtime by cpu
+ * features with a scalar fallback. Build with -DBIGNUM_NO_SIMD to use
+ * the scalar code only.
+ * Add, sub and compare kernels work on 32 bit digits; debug builds keep
+ * the scalar code as a reference.
+ */
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(BIGNUM_NO_SIMD)
+#include <immintrin.h>
+#define SIMD_X86
+#if !defined(DEBUG) && !defined(WIDE_DIGITS)
+#define SIMD_DIGITS
+#endif
+#endif
 
 /*
  * Represents arbitrary precision real number.
  * Uses sign-magnitude form.
- * The implementation is such that bignums are immutable,
- * i.e. functions should not change bignum parameters
+ * Functions do not change their const bignum parameters; the `_into'
+ * functions write their result to their first parameter, reusing its
+ * digits.
  */
+#define SMALL_DIGITS 4 /* digits stored inside struct bignum */
 struct bignum {
 	int sign; /* +ve for -ve bignum, 0 for +ve, any for 0 */
 	int point_offset;
-	int num_digits; /* exact size of digits array; leading zeroes allowed */
-	digit_t *digits;
+	int num_digits; /* digits in use, >= point_offset; leading zeroes allowed */
+	int capacity; /* allocated size of digits array, >= num_digits */
+	int arena; /* non-zero if the bignum and its digits live in an arena */
+	digit_t *digits; /* points to small, to the heap or into the arena */
+	digit_t small[SMALL_DIGITS];
 };
 
 /*
- * Allocate a bignum with `num_digits' digits.
- * Also set its `num_digits' field.
- * Digits are initialized to 0 (needed in some functions).
- * sign and point_offset are initialized to 0.
- * Exit with failure if malloc fails.
+ * Statistics per operation, built with -DBIGNUM_STATS. Otherwise the
+ * STAT_ macros expand to nothing and bignum_stats_get returns -1.
+ * An operation counts its calls, the bignum digits of its operands,
+ * the heap allocations made for bignums while it is the innermost
+ * operation running in its thread, and its time. Operations nested in
+ * others (the products of pow, say) are counted on their own as well,
+ * so times include those of nested operations.
+ * With the environment variable BIGNUM_STATS set, the statistics are
+ * printed to stderr at exit.
  */
-static struct bignum *bignum_alloc(int num_digits) {
-	struct bignum *ptr = malloc(sizeof(struct bignum));
-	if (!ptr) return NULL;
-	ptr->digits = calloc(num_digits, sizeof(digit_t));
-	if (!ptr->digits) exit(EXIT_FAILURE);
-	ptr->num_digits = num_digits;
-	ptr->sign = 0;
-	ptr->point_offset = 0;
-	return ptr;
-}
+#ifdef BIGNUM_STATS
+#include <stdatomic.h>
+#include <time.h>
 
-/*
- * Free the memory of a bignum.
- */
-void bignum_free(struct bignum *ptr) {
-	free(ptr->digits);
-	free(ptr);
+static const char *const STAT_NAMES[] = {
+	"parse", "format", "add", "sub", "mul", "div", "sqrt", "pow"
+};
+static struct {
+	atomic_ullong calls, limbs, allocs, bytes, ns;
+} stats[BIGNUM_STAT_OPS];
+static _Thread_local int stat_op = -1; // innermost operation running
+static pthread_once_t stat_once = PTHREAD_ONCE_INIT;
+
+#define STAT_ADD(field, v) atomic_fetch_add_explicit(&(field), (v), memory_order_relaxed)
+
+static unsigned long long stat_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
 }
 
-/*
- * Clone a bignum.
- */
-struct bignum *clone(const struct bignum *num) {
-	struct bignum *ret = bignum_alloc(num->num_digits);
-	ret->sign = num->sign;
-	ret->point_offset = num->point_offset;
-	for (int i = 0; i < num->num_digits; ++i) {
-		ret->digits[i] = num->digits[i];
+static void stat_dump(void) {
+	struct bignum_stats s[BIGNUM_STAT_OPS];
+	bignum_stats_get(s);
+	fprintf(stderr, "%-8s %12s %14s %12s %16s %14s\n", "op", "calls", "limbs", "allocs", "bytes", "ms");
+	for (int op = 0; op < BIGNUM_STAT_OPS; ++op) {
+		if (!s[op].calls) continue;
+		fprintf(stderr, "%-8s %12llu %14llu %12llu %16llu %14.3f\n", STAT_NAMES[op], s[op].calls,
+				s[op].limbs, s[op].allocs, s[op].bytes, s[op].ns / 1e6);
 	}
-	return ret;
 }
 
-/*
- * Returns absolute value of num.
- */
-struct bignum *bignum_abs(const struct bignum *num) {
-	struct bignum *ret = clone(num);
-	ret->sign = 0;
-	return ret;
+static void stat_init(void) {
+	if (getenv("BIGNUM_STATS")) atexit(stat_dump);
 }
 
-static const unsigned POW10[] = {
-	1,
-	10,
-	100,
-	1000,
-	10000,
-	100000,
-	1000000,
-	10000000,
-	100000000,
-	1000000000 // 1e9
+struct stat_scope {
+	int saved; // operation running when this one began
+	unsigned long long start;
 };
 
-#define MINUS_CHAR '-'
-#define DOT_CHAR '.'
-#define ZERO_CHAR '0'
+static void stat_begin(struct stat_scope *sc, int op, long long limbs) {
+	pthread_once(&stat_once, stat_init);
+	STAT_ADD(stats[op].calls, 1);
+	STAT_ADD(stats[op].limbs, limbs);
+	sc->saved = stat_op;
+	stat_op = op;
+	sc->start = stat_now();
+}
+
+static void stat_end(struct stat_scope *sc) {
+	STAT_ADD(stats[stat_op].ns, stat_now() - sc->start);
+	stat_op = sc->saved;
+}
+
+static void stat_alloc(size_t bytes) {
+	if (stat_op < 0) return;
+	STAT_ADD(stats[stat_op].allocs, 1);
+	STAT_ADD(stats[stat_op].bytes, bytes);
+}
 
 /*
- * Convert string to bignum.
- * Return NULL on error.
+ * Copy the statistics of all threads into out[0..BIGNUM_STAT_OPS).
+ * Return 0, or -1 if the library is built without statistics.
  */
-struct bignum *string_to_bignum(const char *str) {
-	int len = strlen(str);
-	int neg = *str == MINUS_CHAR; // is it negative?
-
-	char *dot = strchr(str, DOT_CHAR);
-	int flt = dot != NULL; // is floating point present
-	int ofs;
-	if (flt) ofs = len - (dot - str) - 1;
-	else ofs = 0;
-	// number of zeroes to be added to the right for alignment
-	int rhz = RNUM - ofs % RNUM;
-	if (rhz == RNUM) rhz = 0;
-	ofs = ofs / RNUM + (ofs % RNUM != 0); // offset of floating point
-
-	int ndw; // number of digits in the whole part
-	if (dot) {
-		ndw = dot - str - neg;
-	} else {
-		ndw = len - neg;
+int bignum_stats_get(struct bignum_stats *out) {
+	for (int op = 0; op < BIGNUM_STAT_OPS; ++op) {
+		out[op].calls = atomic_load_explicit(&stats[op].calls, memory_order_relaxed);
+		out[op].limbs = atomic_load_explicit(&stats[op].limbs, memory_order_relaxed);
+		out[op].allocs = atomic_load_explicit(&stats[op].allocs, memory_order_relaxed);
+		out[op].bytes = atomic_load_explicit(&stats[op].bytes, memory_order_relaxed);
+		out[op].ns = atomic_load_explicit(&stats[op].ns, memory_order_relaxed);
 	}
-	ndw = ndw / RNUM + (ndw % RNUM != 0);
-	int nd = ndw + ofs; // number of bignum digits
-
-	struct bignum *ret = bignum_alloc(nd);
-	if (!ret) return NULL;
-	ret->sign = neg;
-	ret->point_offset = ofs;
+	return 0;
+}
 
-	int bdc = 0; // bignum digit counter
-	int ddc = rhz; // decimal digit counter, handles padding
-	for (int i = 0; i < len - neg; ++i) { // skip minus sign
-		char ch = str[len - i - 1];
-		if (ch == DOT_CHAR) continue; // skip point
-		int dd = ch - ZERO_CHAR; // decimal digit
-		ret->digits[bdc] += dd * POW10[ddc];
-		if (ddc == RNUM - 1) {
-			ddc = 0;
-			++bdc;
-		} else {
-			++ddc;
-		}
+/*
+ * Zero the statistics of all threads.
+ */
+void bignum_stats_reset(void) {
+	for (int op = 0; op < BIGNUM_STAT_OPS; ++op) {
+		atomic_store_explicit(&stats[op].calls, 0, memory_order_relaxed);
+		atomic_store_explicit(&stats[op].limbs, 0, memory_order_relaxed);
+		atomic_store_explicit(&stats[op].allocs, 0, memory_order_relaxed);
+		atomic_store_explicit(&stats[op].bytes, 0, memory_order_relaxed);
+		atomic_store_explicit(&stats[op].ns, 0, memory_order_relaxed);
 	}
+}
 
-	return ret;
+#define STAT_BEGIN(op, limbs) struct stat_scope stat_scope; stat_begin(&stat_scope, (op), (limbs))
+#define STAT_END() stat_end(&stat_scope)
+#define STAT_ALLOC(bytes) stat_alloc(bytes)
+#else
+#define STAT_BEGIN(op, limbs)
+#define STAT_END()
+#define STAT_ALLOC(bytes)
+
+int bignum_stats_get(struct bignum_stats *out) {
+	memset(out, 0, BIGNUM_STAT_OPS * sizeof(struct bignum_stats));
+	return -1;
 }
 
+void bignum_stats_reset(void) {
+}
+#endif
+
 /*
- * Convert bignum to string.
- * Return NULL on error.
+ * Per thread arena for bignums and their digits.
+ * Memory is handed out from chunks by bumping a pointer and released
+ * all at once when the scope that requested it ends.
+ * Scopes nest, each one remembers where the arena stood when it began.
+ * Blocks are of ARENA_ALIGN << k bytes for a size class k, and those
+ * given back by bignum_free go to a free list of their class in the
+ * innermost scope, to be handed out again until the scope ends. Blocks
+ * of more than ARENA_LARGE bytes are taken from the heap one by one
+ * instead, tagged with the depth of their scope, and bignum_free gives
+ * them back at once. So the temporaries of an operation do not pile up
+ * in its scope. The first chunk of a thread is kept when its outermost
+ * scope ends, for the next scope, and freed when the thread exits.
  */
-#define TEN 10
-#define ZERO_STRING "0"
-// maximum number of characters after point (fractional decimal digits)
-#define FDMAX 20
-char *bignum_to_string(const struct bignum *num) {
-	int ofsdi = num->point_offset - 1; // offset digit index; . is to its left
-	int fnzdi; // first non-zero digit index
-	for (fnzdi = 0; fnzdi < num->num_digits && !num->digits[fnzdi]; ++fnzdi);
-	if (fnzdi == num->num_digits) return ZERO_STRING;
-	int lnzdi; // last non-zero digit index
-	for (lnzdi = num->num_digits - 1; lnzdi >= 0 && !num->digits[lnzdi]; --lnzdi);
-
-	// length of returned string
-	int len = num->num_digits * RNUM + !num->point_offset + num->sign;
-	// uses some extra memory, but that's ok
-#ifdef DEBUG
-	char *ret = malloc((len + num->num_digits + 2) * sizeof(char));
-#else
-	char *ret = malloc((len + 2) * sizeof(char)); // +2 for '\0' and 0.
-#endif
-	char *iter = ret;
+#define ARENA_CHUNK (64 * 1024) /* default chunk size in bytes */
+#define ARENA_ALIGN 16
+#define ARENA_CLASSES 9
+#define ARENA_LARGE (ARENA_ALIGN << (ARENA_CLASSES - 1))
+#define ARENA_MAX_DEPTH 16
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+struct arena_chunk {
+	struct arena_chunk *prev;
+	size_t size; /* usable bytes after the header */
+	size_t used;
+};
+#define ARENA_HEADER ARENA_ROUND(sizeof(struct arena_chunk))
+struct arena_large {
+	struct arena_large *older, *newer;
+	int depth; /* of the scope it belongs to */
+};
+#define LARGE_HEADER ARENA_ROUND(sizeof(struct arena_large))
+static _Thread_local struct {
+	struct arena_chunk *top;
+	struct arena_large *large; /* newest first, so deepest first */
+	int depth; /* number of open scopes, allocate from the arena if > 0 */
+	int registered; /* to be freed at thread exit */
+	struct {
+		struct arena_chunk *chunk;
+		size_t used;
+	} marks[ARENA_MAX_DEPTH];
+	void *free[ARENA_MAX_DEPTH + 1][ARENA_CLASSES]; /* by depth and class */
+} arena;
 
-	if (num->sign) *iter++ = MINUS_CHAR;
+static pthread_once_t arena_once = PTHREAD_ONCE_INIT;
+static pthread_key_t arena_key;
 
-	// display 0 digits left or right of point if all non-zero digits lie on one side
-	if (fnzdi > ofsdi + 1) {
-		fnzdi = ofsdi + 1;
+/*
+ * Free the memory of the arena of the exiting thread.
+ */
+static void arena_exit(void *unused) {
+	(void)unused;
+	while (arena.top) {
+		struct arena_chunk *prev = arena.top->prev;
+		free(arena.top);
+		arena.top = prev;
 	}
-	if (lnzdi <= ofsdi) {
-		lnzdi = ofsdi;
-		*iter++ = ZERO_CHAR; // 0.1 instead of .1
+	while (arena.large) {
+		struct arena_large *older = arena.large->older;
+		free(arena.large);
+		arena.large = older;
 	}
+}
 
-	int point_set = 0; // has point been put?
-	int fdctr = 0; // fractional digit counter
-	for (int di = lnzdi; di >= fnzdi; --di) {
-		if (di == ofsdi) {
-			// put floating point (if not at the end)
-			*iter++ = DOT_CHAR;
-			point_set = 1;
-		}
+static void arena_init(void) {
+	if (pthread_key_create(&arena_key, arena_exit)) exit(EXIT_FAILURE);
+}
 
-		char *mtmp = malloc((RNUM + 2) * sizeof(char));
-		char *tmp = mtmp;
-		++tmp; // to allow post decrementing the base pointer
-		int ctr = 0; // number of digits
-		unsigned cpy = num->digits[di];
-		while (cpy) {
-			++ctr;
-			*tmp++ = (char)(cpy % TEN + ZERO_CHAR);
-			cpy /= TEN;
-		}
-		// add zeroes unless left-most and left of point
-		if (di != lnzdi || di <= ofsdi) {
-			for (int j = 0; j < RNUM - ctr; ++j) {
-				if (fdctr < FDMAX) {
-					*iter++ = ZERO_CHAR;
-					if (point_set) ++fdctr;
-				}
-			}
-		}
-		// add decimal digit chars
-		while (ctr--) {
-			char ch = *--tmp;
-			if (fdctr < FDMAX) {
-				*iter++ = ch;
-				if (point_set) ++fdctr;
-			}
-		}
-		free(mtmp);
-#ifdef DEBUG
-		*iter++ = '_';
-#endif
-	}
-	// remove extra zeroes after point
-	if (fnzdi <= ofsdi) {
-#ifdef DEBUG
-		for (--iter; *iter == ZERO_CHAR || *iter == '_'; --iter);
-#else
-		while (*--iter == ZERO_CHAR);
-#endif
-		++iter;
-	}
-	*iter = '\0';
-	return ret;
+/*
+ * Have the arena of this thread freed when the thread exits.
+ */
+static void arena_register(void) {
+	if (arena.registered) return;
+	pthread_once(&arena_once, arena_init);
+	pthread_setspecific(arena_key, &arena);
+	arena.registered = 1;
 }
 
 /*
- * Get digit at position `ind' from `num'.
- * Position 0 is just left of point.
- * +ve, -ve positions even outside those stored are supported.
+ * Return the size class of blocks of `size' <= ARENA_LARGE bytes.
  */
-static digit_t get_digit(const struct bignum *num, int ind) {
-	int di = ind + num->point_offset;
-	if (di < 0 || di >= num->num_digits) return 0;
-	return num->digits[di];
+static int arena_class(size_t size) {
+	int k = 0;
+	while ((size_t)ARENA_ALIGN << k < size) ++k;
+	return k;
 }
 
 /*
- * Add ignoring sign.
- * TODO: learn how to free returned bignum later.
- * todos apply to other functions as well.
+ * Unlink large block l from the arena of this thread.
  */
-#define max(x, y) ((x) > (y) ? (x) : (y))
-static struct bignum *add_unsigned(const struct bignum *a, const struct bignum *b) {
-	int rofs = max(a->point_offset, b->point_offset); // resulting point offset
-	// resulting number of digits in whole number part
-	int rwnd = 1 + max(a->num_digits - a->point_offset, b->num_digits - b->point_offset);
-	struct bignum *ret = bignum_alloc(rwnd + rofs);
-	ret->point_offset = rofs;
-	digit_t carry = 0;
-	for (int i = -rofs; i < rwnd; ++i) { // last carry included
-		digit_t tmp = get_digit(a, i) + get_digit(b, i) + carry;
-		if (tmp >= RADIX) {
-			tmp -= RADIX;
-			carry = 1;
-		} else {
-			carry = 0;
-		}
-		ret->digits[i + rofs] = tmp;
-	}
-	return ret;
+static void large_unlink(struct arena_large *l) {
+	if (l->newer) l->newer->older = l->older;
+	else arena.large = l->older;
+	if (l->older) l->older->newer = l->newer;
 }
 
 /*
- * Subtract ignoring sign.
- * Use only for a >= b.
- * Return a - b.
+ * Resize large block ptr, or take a new one if ptr is NULL, to `size'
+ * bytes. A resized block keeps its scope. Exit with failure if realloc
+ * fails.
  */
-static struct bignum *sub_unsigned(const struct bignum *a, const struct bignum *b) {
-	int rofs = max(a->point_offset, b->point_offset); // resulting point offset
-	// resulting number of digits in whole number part, assuming a >= b
-	int rwnd = a->num_digits - a->point_offset;
-	struct bignum *ret = bignum_alloc(rwnd + rofs);
-	ret->point_offset = rofs;
-	digit_t borrow = 0;
-	for (int i = -rofs; i < rwnd; ++i) {
-		digit_t da = get_digit(a, i);
-		if (borrow) {
-			if (da) {
-				--da;
-				borrow = 0;
-			} else {
-				da = RADIX - 1;
-				borrow = 1;
-			}
-		}
-		digit_t db = get_digit(b, i);
-		digit_t tmp;
-		if (da >= db) {
-			tmp = da - db; // do not add borrow = 0 here
-		} else {
-			tmp = da + RADIX - db;
-			borrow = 1;
-		}
-		ret->digits[i + rofs] = tmp;
+static void *large_realloc(void *ptr, size_t size) {
+	struct arena_large *l = ptr ? (struct arena_large *)((char *)ptr - LARGE_HEADER) : NULL;
+	l = realloc(l, LARGE_HEADER + size);
+	if (!l) exit(EXIT_FAILURE);
+	STAT_ALLOC(LARGE_HEADER + size);
+	if (!ptr) {
+		arena_register();
+		l->depth = arena.depth;
+		l->older = arena.large;
+		l->newer = NULL;
 	}
-	return ret;
+	// relink it where it moved
+	if (l->newer) l->newer->older = l;
+	else arena.large = l;
+	if (l->older) l->older->newer = l;
+	return (char *)l + LARGE_HEADER;
 }
 
 /*
- * Return -ve if |a| < |b|, 0 if |a| == |b|, +ve if |a| > |b|.
+ * Return `size' bytes from the arena of this thread.
+ * Exit with failure if malloc fails.
  */
-int mag_comp(const struct bignum *a, const struct bignum *b) {
-	int rofs = max(a->point_offset, b->point_offset); // resulting point offset
-	// resulting number of digits in whole number part
-	int rwnd = max(a->num_digits - a->point_offset, b->num_digits - b->point_offset);
-
-	// do not compare sizes, as leading digits may be zero
-	// avoid unsigned subtraction
-	for (int i = rwnd - 1; i >= -rofs; --i) {
-		digit_t da = get_digit(a, i);
-		digit_t db = get_digit(b, i);
-		if (da < db) return -1;
-		if (da > db) return 1;
+static void *arena_alloc(size_t size) {
+	if (size > ARENA_LARGE) return large_realloc(NULL, size);
+	int k = arena_class(size);
+	void **list = &arena.free[arena.depth][k];
+	if (*list) {
+		void *ptr = *list;
+		*list = *(void **)ptr;
+		return ptr;
 	}
-	return 0;
+	size = (size_t)ARENA_ALIGN << k;
+	struct arena_chunk *c = arena.top;
+	if (!c || c->size - c->used < size) {
+		c = malloc(ARENA_HEADER + ARENA_CHUNK);
+		if (!c) exit(EXIT_FAILURE);
+		STAT_ALLOC(ARENA_HEADER + ARENA_CHUNK);
+		arena_register();
+		c->prev = arena.top;
+		c->size = ARENA_CHUNK;
+		c->used = 0;
+		arena.top = c;
+	}
+	void *ptr = (char *)c + ARENA_HEADER + c->used;
+	c->used += size;
+	return ptr;
 }
 
 /*
- * Signed add if `sub' = 0, signed sub if `sub' = 1.
+ * Give back ptr, taken from the arena with `size' bytes.
  */
-struct bignum *addsub_signed(const struct bignum *a, const struct bignum *b, int sub) {
-	int sa = a->sign;
-	int sb = b->sign ^ sub;
-	struct bignum *ret;
-	if (sa == sb) {
-		ret = add_unsigned(a, b);
-		ret->sign = sa;
+static void arena_free(void *ptr, size_t size) {
+	if (size > ARENA_LARGE) {
+		struct arena_large *l = (struct arena_large *)((char *)ptr - LARGE_HEADER);
+		large_unlink(l);
+		free(l);
 	} else {
-		if (mag_comp(a, b) > 0) {
-			ret = sub_unsigned(a, b);
-			ret->sign = sa;
-		} else {
-			ret = sub_unsigned(b, a);
-			ret->sign = sb;
-		}
+		void **list = &arena.free[arena.depth][arena_class(size)];
+		*(void **)ptr = *list;
+		*list = ptr;
 	}
-	return ret;
 }
 
 /*
- * Return a * b (signed).
- * Use long multiplication.
+ * Resize ptr, taken from the arena with `size' bytes, to `new_size'
+ * bytes, new_size > size, keeping its contents. Blocks that have room
+ * and large blocks are resized in place if they can be.
  */
-typedef unsigned long long lldigit_t;
-struct bignum *long_mul(const struct bignum *a, const struct bignum *b) {
-	struct bignum *ret = bignum_alloc(a->num_digits + b->num_digits);
-	ret->sign = a->sign ^ b->sign;
-	ret->point_offset = a->point_offset + b->point_offset;
-	for (int ai = 0; ai < a->num_digits; ++ai) {
-		lldigit_t carry = 0;
-		for (int bi = 0; bi < b->num_digits; ++bi) {
-			lldigit_t tmp = (lldigit_t)a->digits[ai] * b->digits[bi];
-			tmp += ret->digits[ai + bi] + carry;
-			ret->digits[ai + bi] = tmp % RADIX;
-			carry = tmp / RADIX;
-		}
-		ret->digits[ai + b->num_digits] = carry;
-	}
+static void *arena_realloc(void *ptr, size_t size, size_t new_size) {
+	if (size > ARENA_LARGE) return large_realloc(ptr, new_size);
+	if (new_size <= ARENA_LARGE && arena_class(new_size) == arena_class(size)) return ptr;
+	void *ret = arena_alloc(new_size);
+	memcpy(ret, ptr, size);
+	arena_free(ptr, size);
 	return ret;
 }
 
-// number of bignum digits after point to which div and sqrt are computed
-#define PRECISION 5
 /*
- * Return signed a/b to `PRECISION' bignum digits of precision after point.
- * Use long division.
- * Return NULL when b = 0.
+ * Start an arena scope in this thread.
+ * Until the matching bignum_arena_end, new bignums and their digits are
+ * taken from the arena. They are all released by bignum_arena_end and
+ * must not be used after it; bignum_free on them gives their memory back
+ * to the scope.
+ * Bignums created outside the scope keep using the heap.
+ * Return 0, or -1 if scopes are nested too deep.
  */
-struct bignum *long_div(const struct bignum *a, const struct bignum *b) {
-	int lzb; // number of leading zeroes in b
-	for (lzb = 0; lzb < b->num_digits && !b->digits[b->num_digits - 1 - lzb]; ++lzb);
-	if (lzb == b->num_digits) {
-		// division by zero
-		return NULL;
+int bignum_arena_begin(void) {
+	if (arena.depth == ARENA_MAX_DEPTH) return -1;
+	arena.marks[arena.depth].chunk = arena.top;
+	arena.marks[arena.depth].used = arena.top ? arena.top->used : 0;
+	++arena.depth;
+	return 0;
+}
+
+/*
+ * End the innermost arena scope in this thread, releasing all bignums
+ * created since the matching bignum_arena_begin.
+ */
+void bignum_arena_end(void) {
+	if (!arena.depth) return;
+	memset(arena.free[arena.depth], 0, sizeof(arena.free[arena.depth]));
+	--arena.depth;
+	while (arena.large && arena.large->depth > arena.depth) {
+		struct arena_large *older = arena.large->older;
+		free(arena.large);
+		arena.large = older;
 	}
-	// number of digits in b ignoring leading zeroes
-	// important for deciding the leading digit place of quotient
-	int bnd = b->num_digits - lzb;
-	// number of zeroes appended to a for precision
-	int naz = PRECISION + b->point_offset - a->point_offset;
-	struct bignum *ret = bignum_alloc(a->num_digits + naz - bnd + 1);
-	ret->sign = a->sign ^ b->sign;
-	ret->point_offset = PRECISION;
-	// intermediate remainder at each step
-	struct bignum *rem = bignum_alloc(a->num_digits + naz + 1);
-	// initialize remainder
-	for (int i = 0; i < a->num_digits; ++i) {
-		rem->digits[naz + i] = a->digits[i];
-	}
-	// hide other digits by shifting pointer
-	rem->digits += a->num_digits + naz - bnd + 1;
-	// the number of digits of remainder under consideration at every step
-	rem->num_digits = bnd + 1;
-	// digit being checked at each step
-	struct bignum *dig = bignum_alloc(1);
-	// copy of b wihtout it's point_offset
-	struct bignum *bcpy = malloc(sizeof(struct bignum));
-	bcpy->point_offset = 0;
-	bcpy->num_digits = bnd;
-	bcpy->digits = b->digits;
-	for (int ai = a->num_digits - bnd; ai >= -naz; --ai) {
-		// expose a new digit of rem
-		--rem->digits;
-		// binary search next digit of quotient
-		// TODO: make it digit_t
-		digit_t lo = 0, hi = RADIX - 1;	
-		digit_t mid;
-		struct bignum *isub; // intermediate subtraction result
-		while (hi >= lo) {
-			mid = (lo + hi)/2;
-			dig->digits[0] = mid;
-			struct bignum *tmp = long_mul(dig, bcpy);
-			int comp = mag_comp(tmp, rem);
-			if (comp <= 0) {
-				isub = sub_unsigned(rem, tmp);
-				if (mag_comp(isub, bcpy) < 0) {
-					break;
-				} else {
-					lo = mid + 1;
-				}
-			} else {
-				hi = mid - 1;
-			}
-		}
-		ret->digits[ai + naz] = mid;
-		// overwrite rem with isub
-		for (int ri = 0; ri < rem->num_digits; ++ri) {
-			rem->digits[ri] = isub->digits[ri];
+	if (arena.large) arena.large->newer = NULL;
+	struct arena_chunk *mark = arena.marks[arena.depth].chunk;
+	while (arena.top != mark) {
+		struct arena_chunk *prev = arena.top->prev;
+		if (!prev) {
+			// keep the first chunk for the next scope
+			arena.top->used = 0;
+			return;
 		}
+		free(arena.top);
+		arena.top = prev;
 	}
-	free(bcpy);
-	bignum_free(dig);
-	bignum_free(rem);
-	return ret;
+	if (arena.top) arena.top->used = arena.marks[arena.depth].used;
 }
 
-// TODO: error checking
-// TODO: can bignum_to_string handle num_digits = 0?
-// TODO: does .00000000000000000000000 break it?
+/*
+ * Initialize num as an empty bignum using its inline digits.
+ * `in_arena' tells where larger digit arrays are to be allocated.
+ */
+static void bignum_init(struct bignum *num, int in_arena) {
+	num->sign = 0;
+	num->point_offset = 0;
+	num->num_digits = 0;
+	num->capacity = SMALL_DIGITS;
+	num->arena = in_arena;
+	num->digits = num->small;
+}
 
 /*
- * Trims the bignum to `precision' bignum digits of precision.
+ * Free the digits of num if they are on the heap. Digits in an arena go
+ * to the free list of their size class in the innermost scope, to be
+ * reused, and large ones are freed.
  */
-static struct bignum *trim_fraction(const struct bignum *num, int precision) {
-	struct bignum *ret = bignum_alloc(num->num_digits - num->point_offset + precision);
-	ret->sign = num->sign;
-	ret->point_offset = precision;
-	for (int i = 0; i < ret->num_digits; ++i) {
-		ret->digits[i] = num->digits[i + num->point_offset - precision];
-	}
-	return ret;
+static void digits_free(struct bignum *num) {
+	if (num->digits == num->small) return;
+	if (num->arena) arena_free(num->digits, num->capacity * sizeof(digit_t));
+	else free(num->digits);
 }
 
+#define max(x, y) ((x) > (y) ? (x) : (y))
 /*
- * Return sqrt a to `PRECISION' bignum digits of precision.
- * Ignore sign.
+ * Resize num to `num_digits' digits, reusing its capacity if it suffices.
+ * Existing digits are kept, new digits are not initialized.
+ * Exit with failure if allocation fails.
  */
-static struct bignum *sqrt_unsigned(const struct bignum *a) {
-	// this prevents naz (defined below) from being negative.
-	if (a->point_offset > PRECISION*2) {
-		trim_fraction(a, PRECISION*2);
-	}
-	// sz is number of digits in a after adding zeroes left and right
-	// to get paired digits that give required precision
-	// sz is even
-	int wnd = a->num_digits - a->point_offset; // digits in whole number part
-	int sz = wnd + (wnd & 1) + PRECISION*2;
-	struct bignum *ret = bignum_alloc(sz/2); // answer
-	// hide all digits of ret
-	ret->digits += sz/2;
-	ret->num_digits = 0;
-	struct bignum *rem = bignum_alloc(sz + 1); // intermediate remainder
-	int naz = PRECISION*2 - a->point_offset; // number of zeroes added for precision
-	// initialize remainder
-	for (int i = 0; i < a->num_digits; ++i) {
-		rem->digits[i + naz] = a->digits[i];
-	}
-	// hide all digits of rem
-	rem->digits += sz;
-	rem->num_digits = 1;
-	struct bignum *dig = bignum_alloc(1); // placeholder for small numbers
-	struct bignum *rad = bignum_alloc(2); // bignum representation of RADIX
-	rad->digits[1] = 1;
-	for (int i = 0; i < sz/2; ++i) { // an iteration for each digit in ret
-		// expose 2 digits of rem
-		rem->digits -= 2;
-		rem->num_digits += 2;
-		// binary search the digit
-		digit_t lo = 0, hi = RADIX - 1;
-		digit_t el; // will store max x s.t. (2*ret*RADIX + x)*x <= rem
-		struct bignum *tmpel = NULL; // store tmp for the el
-		while (hi >= lo) {
-			digit_t mid = (lo + hi)/2;
-			dig->digits[0] = 2;
-			struct bignum *tmp1 = long_mul(dig, ret);
-			struct bignum *tmp2 = long_mul(rad, tmp1);
-			dig->digits[0] = mid;
-			struct bignum *tmp3 = add_unsigned(dig, tmp2);
-			struct bignum *tmp = long_mul(dig, tmp3);
-			// final result: tmp = (2*ret*RADIX + mid)*mid
-
-			int comp = mag_comp(tmp, rem);
-			if (comp <= 0) {
-				el = mid;
-				if (tmpel != NULL) bignum_free(tmpel);
-				tmpel = bignum_alloc(tmp->num_digits);
-				for (int j = 0; j < tmp->num_digits; ++j) {
-					tmpel->digits[j] = tmp->digits[j];
-				}
-				lo = mid + 1;
+static void bignum_resize(struct bignum *num, int num_digits) {
+	if (num_digits > num->capacity) {
+		// grow geometrically so that accumulating into num stays cheap
+		int capacity = max(num_digits, num->capacity + num->capacity / 2);
+		digit_t *digits;
+		if (num->digits != num->small && !num->arena) {
+			digits = realloc(num->digits, capacity * sizeof(digit_t));
+			if (!digits) exit(EXIT_FAILURE);
+			STAT_ALLOC(capacity * sizeof(digit_t));
+		} else if (num->arena && num->digits != num->small) {
+			digits = arena_realloc(num->digits, num->capacity * sizeof(digit_t), capacity * sizeof(digit_t));
+		} else {
+			if (num->arena) {
+				digits = arena_alloc(capacity * sizeof(digit_t));
 			} else {
-				hi = mid - 1;
+				digits = malloc(capacity * sizeof(digit_t));
+				STAT_ALLOC(capacity * sizeof(digit_t));
 			}
-
-			bignum_free(tmp1);
-			bignum_free(tmp2);
-			bignum_free(tmp3);
-			bignum_free(tmp);
-		}
-		// add el to result
-		--ret->digits;
-		++ret->num_digits;
-		ret->digits[0] = el;
-		// update the remainder by overwriting with rem - tmpel
-		struct bignum *sub = sub_unsigned(rem, tmpel);
-		for (int j = 0; j < rem->num_digits; ++j) {
-			rem->digits[j] = sub->digits[j];
+			if (!digits) exit(EXIT_FAILURE);
+			memcpy(digits, num->digits, num->num_digits * sizeof(digit_t));
 		}
-		bignum_free(sub);
-		bignum_free(tmpel);
+		num->digits = digits;
+		num->capacity = capacity;
 	}
-	ret->point_offset = PRECISION;
-	bignum_free(rad);
-	bignum_free(dig);
-	bignum_free(rem);
-	return ret;
+	num->num_digits = num_digits;
 }
 
 /*
- * Return sqrt(a) if a is non-negative.
- * Else return NULL.
+ * Allocate a bignum with `num_digits' digits.
+ * Also set its `num_digits' field.
+ * Digits are initialized to 0 (needed in some functions).
+ * sign and point_offset are initialized to 0.
+ * Small bignums keep their digits inline, so a single allocation is made.
+ * Inside an arena scope, nothing is taken from the heap.
+ * Exit with failure if malloc fails.
  */
-struct bignum *sqrt_signed(const struct bignum *a) {
-	if (a->sign && strcmp(bignum_to_string(a), ZERO_STRING) != 0) {
-		return NULL;
+static struct bignum *bignum_alloc(int num_digits) {
+	struct bignum *ptr;
+	if (arena.depth) {
+		ptr = arena_alloc(sizeof(struct bignum));
+	} else {
+		ptr = malloc(sizeof(struct bignum));
+		STAT_ALLOC(sizeof(struct bignum));
 	}
-	return sqrt_unsigned(a);
+	if (!ptr) return NULL;
+	bignum_init(ptr, arena.depth);
+	bignum_resize(ptr, num_digits);
+	memset(ptr->digits, 0, num_digits * sizeof(digit_t));
+	return ptr;
 }
 
 /*
- * Raise to small exponents.
- * Return a ^ b.
- * Ignore sign of a, b expected to be non-negative.
+ * Free the memory of a bignum.
+ * A bignum in an arena is given back to the innermost scope, to be
+ * reused until the scope ends.
  */
-static struct bignum *pow_small(const struct bignum *a, int b) {
-	struct bignum *ret = bignum_alloc(1);
-	ret->digits[0] = 1;
-	struct bignum *tmp = clone(a);
-	while (b) {
-		if (b & 1) {
-			struct bignum *retcpy = ret;
-			ret = long_mul(ret, tmp);
-			bignum_free(retcpy);
-		}
-		struct bignum *tmpcpy = tmp;
-		tmp = long_mul(tmp, tmp);
-		bignum_free(tmpcpy);
-		b /= 2;
-	}
-	bignum_free(tmp);
-	return ret;
+void bignum_free(struct bignum *ptr) {
+	digits_free(ptr);
+	if (ptr->arena) arena_free(ptr, sizeof(struct bignum));
+	else free(ptr);
 }
 
 /*
- * Raise to arbitrary integer exponents (i.e. ignoring point_offset).
- * Return a ^ b.
- * Ignore signs of a and b.
+ * Replace dst by tmp, a bignum on the stack that is not used afterwards
+ * and was initialized with the arena flag of dst.
+ * The `_into' functions compute into tmp when dst aliases an operand
+ * they cannot overwrite.
  */
-static struct bignum *pow_uint(const struct bignum *a, const struct bignum *b) {
-	struct bignum *ret = bignum_alloc(1);
-	ret->digits[0] = 1;
-	struct bignum *acc = clone(a);
-	for (int i = 0; i < b->num_digits; ++i) {
-		struct bignum *tmp = pow_small(acc, b->digits[i]);
-		struct bignum *retcpy = ret;
-		ret = long_mul(ret, tmp);
-		bignum_free(retcpy);
-		if (i != b->num_digits - 1) {
-			struct bignum *acccpy = acc;
-			acc = pow_small(acc, RADIX);
-			bignum_free(acc);
-		}
-		bignum_free(tmp);
+static void bignum_take(struct bignum *dst, struct bignum *tmp) {
+	digits_free(dst);
+	dst->sign = tmp->sign;
+	dst->point_offset = tmp->point_offset;
+	dst->num_digits = tmp->num_digits;
+	dst->capacity = tmp->capacity;
+	if (tmp->digits == tmp->small) {
+		memcpy(dst->small, tmp->small, sizeof(tmp->small));
+		dst->digits = dst->small;
+	} else {
+		dst->digits = tmp->digits;
 	}
-	bignum_free(acc);
-	return ret;
 }
 
 /*
- * Raise to unsigned fractional exponent.
- * Return a ^ b.
- * Ignore signs of a and b.
- * Works for 0 <= b < 1.
+ * Return a new bignum equal to 0.
+ * Meant as a destination for the `_into' functions.
  */
-static struct bignum *pow_ufrac(const struct bignum *a, double b) {
-	struct bignum *ret = bignum_alloc(1);
-	ret->digits[0] = 1;
-	struct bignum *tmp = clone(a);
-	while (b) {
-		struct bignum *tmpcpy = tmp;
-		tmp = sqrt_unsigned(tmp);
-		bignum_free(tmpcpy);
-		b *= 2;
-		int d = (int)b;
-		if (d) {
-			struct bignum *retcpy = ret;
-			ret = long_mul(ret, tmp);
-			bignum_free(retcpy);
-		}
-		b -= d;
-	}
-	bignum_free(tmp);
-	return ret;
+struct bignum *bignum_new(void) {
+	return bignum_alloc(0);
 }
 
 /*
- * Raise power to signed ints.
- * Return a ^ b.
- * Sign of a is ignored.
+ * dst = src, reusing the digits of dst.
  */
-static struct bignum *pow_sint(const struct bignum *a, const struct bignum *b) {
-	struct bignum *ret = pow_uint(a, b);
-	if (b->sign) {
-		struct bignum *dig = bignum_alloc(1);
-		dig->digits[0] = 1;
-		struct bignum *retcpy = ret;
-		ret = long_div(dig, ret);
-		bignum_free(retcpy);
-		bignum_free(dig);
-	}
-	return ret;
+void bignum_copy_into(struct bignum *dst, const struct bignum *src) {
+	if (dst == src) return;
+	bignum_resize(dst, src->num_digits);
+	memcpy(dst->digits, src->digits, src->num_digits * sizeof(digit_t));
+	dst->sign = src->sign;
+	dst->point_offset = src->point_offset;
 }
 
 /*
- * Raise power to signed fractions.
- * Return a ^ b.
- * Sign of a is ignored.
+ * Truncate num to `prec' digits after point in place.
+ */
+static void trim_into(struct bignum *num, int prec) {
+	int d = num->point_offset - prec;
+	if (d <= 0) return;
+	memmove(num->digits, num->digits + d, (num->num_digits - d) * sizeof(digit_t));
+	num->num_digits -= d;
+	num->point_offset = prec;
+}
+
+/*
+ * Drop the leading zero digits of num, down to the point.
+ * Products would otherwise carry the zeroes of every step along.
+ */
+static void trim_leading(struct bignum *num) {
+	int n = num->num_digits;
+	while (n > num->point_offset && !num->digits[n - 1]) --n;
+	num->num_digits = n;
+}
+
+/*
+ * Put num in normal form: no zero digits at either end but those
+ * between the point and a non-zero digit after it, and 0 with no digits
+ * and no sign. The capacity is kept for num to be reused.
+ * Results of the public functions are normal, so that operations
+ * chained on them run on the size of the value, not of its history.
  */
-static struct bignum *pow_sfrac(const struct bignum *a, double b) {
-	struct bignum *ret = pow_ufrac(a, b < 0.0 ? -b : b);
-	if (b < 0) {
-		struct bignum *dig = bignum_alloc(1);
-		dig->digits[0] = 1;
-		struct bignum *retcpy = ret;
-		ret = long_div(dig, ret);
-		bignum_free(retcpy);
-		bignum_free(dig);
+static void normalize(struct bignum *num) {
+	trim_leading(num);
+	int k = 0; // zero digits at the end after point
+	while (k < num->point_offset && !num->digits[k]) ++k;
+	if (k == num->num_digits) {
+		num->num_digits = num->point_offset = num->sign = 0;
+		return;
 	}
+	trim_into(num, num->point_offset - k);
+}
+
+/*
+ * num = v, a non-negative integer.
+ */
+static void int_set(struct bignum *num, unsigned long long v) {
+	int n = 0;
+	do {
+		bignum_resize(num, n + 1);
+		num->digits[n++] = v % RADIX;
+		v /= RADIX;
+	} while (v);
+	num->sign = 0;
+	num->point_offset = 0;
+}
+
+/*
+ * Clone a bignum.
+ */
+struct bignum *clone(const struct bignum *num) {
+	struct bignum *ret = bignum_alloc(num->num_digits);
+	bignum_copy_into(ret, num);
 	return ret;
 }
 
 /*
- * Raise to arbitrary bignum powers.
- * Only one bignum digit to the right of point is considered.
- * This is because simple implementations of arbitrary precision
- * to the right may take unreasonable amount of memory for intermediates
- * even when final answer is small enough.
- * Also after 9 digits after point, as ignored by this function,
- * the exponent barely makes a difference.
- *
- * Return NULL if a is negative and b has fractional part.
+ * Returns absolute value of num.
  */
-struct bignum *long_pow(const struct bignum *a, const struct bignum *b) {
-	struct bignum *c; // the integer part of b
-	double d; // the fraction part of b
-	// extract integer and fractional parts
-	// function can be optimized for c = 0 or d = 0 cases
-	if (b->point_offset == 0) {
-		c = clone(b);
-		d = 0;
-	} else {
-		c = trim_fraction(b, 0);
-		d = (double)b->digits[b->point_offset - 1] / RADIX;
-		if (b->sign) d = -d;
-	}
-	if (a->sign && strcmp(bignum_to_string(a), ZERO_STRING) != 0) {
-		if (d != 0) {
-			bignum_free(c);
-			return NULL;
-		}
-	}
-	struct bignum *tmp1 = pow_sint(a, c);
-	struct bignum *tmp2 = pow_sfrac(a, d);
-	struct bignum *ret = long_mul(tmp1, tmp2);
-	bignum_free(c);
-	bignum_free(tmp1);
-	bignum_free(tmp2);
+struct bignum *bignum_abs(const struct bignum *num) {
+	struct bignum *ret = clone(num);
+	ret->sign = 0;
 	return ret;
 }
+
+static const unsigned long long POW10[] = {
+	1,
+	10,
+	100,
+	1000,
+	10000,
+	100000,
+	1000000,
+	10000000,
+	100000000,
+	1000000000, // 1e9
+	10000000000,
+	100000000000,
+	1000000000000,
+	10000000000000,
+	100000000000000,
+	1000000000000000,
+	10000000000000000,
+	100000000000000000,
+	1000000000000000000 // 1e18
+};
+
+#define MINUS_CHAR '-'
+#define DOT_CHAR '.'
+#define ZERO_CHAR '0'
+#define TEN 10
+
+/*
+ * Value of the n <= RNUM decimal characters at s.
+ */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+/*
+ * Value of the 8 decimal characters at s.
+ * All of them are converted at once in a 64 bit word: pairs of digits
+ * are combined, then pairs of pairs, then the two halves.
+ */
+static digit_t parse_8(const char *s) {
+	unsigned long long v;
+	memcpy(&v, s, sizeof(v));
+	v -= 0x3030303030303030ULL;
+	v = v * 10 + (v >> 8);
+	v = ((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))
+		+ ((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32))) >> 32;
+	return (digit_t)(v & 0xFFFFFFFF);
+}
+#define PARSE_8
+#endif
+
+#if defined(SIMD_X86) && defined(WIDE_DIGITS)
+/*
+ * Value of the 16 decimal characters at s, with SSE4.1.
+ * Multiply-adds combine neighbouring digits into 2, 4 and 8 digit values.
+ */
+__attribute__((target("sse4.1")))
+static digit_t parse_16_sse41(const char *s) {
+	__m128i v = _mm_loadu_si128((const __m128i *)s);
+	v = _mm_sub_epi8(v, _mm_set1_epi8(ZERO_CHAR));
+	v = _mm_maddubs_epi16(v, _mm_set_epi8(1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10));
+	v = _mm_madd_epi16(v, _mm_set_epi16(1, 100, 1, 100, 1, 100, 1, 100));
+	v = _mm_packus_epi32(v, v);
+	v = _mm_madd_epi16(v, _mm_set_epi16(1, 10000, 1, 10000, 1, 10000, 1, 10000));
+	digit_t hi = (unsigned)_mm_cvtsi128_si32(v);
+	digit_t lo = (unsigned)_mm_extract_epi32(v, 1);
+	return hi * 100000000 + lo;
+}
+#endif
+
+static digit_t parse_digits(const char *s, int n) {
+	digit_t x = 0;
+#if defined(SIMD_X86) && defined(WIDE_DIGITS)
+	if (n >= 16 && __builtin_cpu_supports("sse4.1")) {
+		x = parse_16_sse41(s);
+		s += 16;
+		n -= 16;
+	}
+#endif
+#ifdef PARSE_8
+	for (; n >= 8; s += 8, n -= 8) x = x * 100000000 + parse_8(s);
+#endif
+	for (int i = 0; i < n; ++i) x = x * TEN + (s[i] - ZERO_CHAR);
+	return x;
+}
+
+/*
+ * Convert the `len' characters at str to bignum, str need not be
+ * terminated. Lets a number be parsed in place from a larger buffer.
+ * Return NULL on error.
+ * The radix is a power of ten, so every bignum digit comes from its own
+ * group of RNUM characters and conversion takes linear time.
+ */
+struct bignum *string_to_bignum_n(const char *str, size_t len) {
+	int neg = len && *str == MINUS_CHAR; // is it negative?
+	const char *whole = str + neg;
+
+	const char *dot = memchr(whole, DOT_CHAR, len - neg);
+	int wlen = dot ? (int)(dot - whole) : (int)len - neg; // decimal digits in the whole part
+	int flen = dot ? (int)len - neg - wlen - 1 : 0; // decimal digits after point
+	int ndw = wlen / RNUM + (wlen % RNUM != 0); // bignum digits in the whole part
+	int ofs = flen / RNUM + (flen % RNUM != 0); // offset of floating point
+
+	STAT_BEGIN(BIGNUM_STAT_PARSE, ndw + ofs);
+	struct bignum *ret = bignum_alloc(ndw + ofs);
+	if (!ret) {
+		STAT_END();
+		return NULL;
+	}
+	ret->sign = neg;
+	ret->point_offset = ofs;
+
+	// whole part, groups are aligned at the point
+	for (int i = 0; i < ndw; ++i) {
+		int end = wlen - i * RNUM;
+		int n = end < RNUM ? end : RNUM;
+		ret->digits[ofs + i] = parse_digits(whole + end - n, n);
+	}
+	// fractional part, the last group is padded with zeroes on the right
+	for (int i = 0; i < ofs; ++i) {
+		int n = flen - i * RNUM < RNUM ? flen - i * RNUM : RNUM;
+		ret->digits[ofs - 1 - i] = parse_digits(dot + 1 + i * RNUM, n) * POW10[RNUM - n];
+	}
+	normalize(ret);
+
+	STAT_END();
+	return ret;
+}
+
+/*
+ * Convert string to bignum.
+ * Return NULL on error.
+ */
+struct bignum *string_to_bignum(const char *str) {
+	return string_to_bignum_n(str, strlen(str));
+}
+
+/*
+ * Precision context of this thread: the number of decimal digits after
+ * point that div, sqrt and pow compute and bignum_to_string prints.
+ * Kernels work with the fewest bignum digits that hold this many.
+ */
+#define DEFAULT_PRECISION 20
+static _Thread_local int precision = DEFAULT_PRECISION;
+
+/*
+ * Set the precision of this thread to `digits' decimal digits after point.
+ * Return 0, or -1 if digits is negative.
+ */
+int bignum_set_precision(int digits) {
+	if (digits < 0) return -1;
+	precision = digits;
+	return 0;
+}
+
+/*
+ * Return the precision of this thread in decimal digits after point.
+ */
+int bignum_get_precision(void) {
+	return precision;
+}
+
+/*
+ * Number of bignum digits after point needed for the current precision.
+ */
+static int precision_digits(void) {
+	return (precision + RNUM - 1) / RNUM;
+}
+
+/*
+ * Normalize num, a result of the public functions, after dropping the
+ * digits after point beyond the precision, which are never printed.
+ */
+static void normalize_prec(struct bignum *num) {
+	trim_into(num, precision_digits());
+	normalize(num);
+}
+
+// decimal digits 00 to 99 as character pairs
+static const char DIGIT_PAIRS[] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+/*
+ * Write the n lowest decimal digits of x at s[0..n), zero padded,
+ * two digits per step.
+ */
+static void write_decimal(char *s, digit_t x, int n) {
+	while (n >= 2) {
+		n -= 2;
+		memcpy(s + n, DIGIT_PAIRS + 2 * (x % 100), 2);
+		x /= 100;
+	}
+	if (n) s[0] = (char)(x % TEN + ZERO_CHAR);
+}
+
+/*
+ * Number of decimal digits in the bignum digit x, at least 1.
+ */
+static int decimal_len(digit_t x) {
+	int n = 1;
+	while (n < RNUM && x >= POW10[n]) ++n;
+	return n;
+}
+
+/*
+ * Shape of the decimal form of a bignum.
+ * All non-zero digits may lie beyond the printed precision,
+ * the number is printed as 0 then.
+ */
+struct layout {
+	int top; // index of the leading non-zero whole digit, -1 if none
+	int flen; // decimal digits after point, trailing zeroes dropped
+	int neg; // print a minus sign
+	size_t len; // characters without '\0'
+};
+
+static void layout(const struct bignum *num, struct layout *lay) {
+	int ofs = num->point_offset;
+	int top;
+	for (top = num->num_digits - 1; top >= ofs && !num->digits[top]; --top);
+	if (top < ofs) top = -1;
+	// decimal digits after point that may be printed
+	int fmax = ofs * RNUM < precision ? ofs * RNUM : precision;
+	int flen = 0;
+	for (int k = (fmax - 1) / RNUM; fmax > 0 && k >= 0; --k) {
+		int i = ofs - 1 - k; // digits are counted down from the point
+		int n = fmax - k * RNUM < RNUM ? fmax - k * RNUM : RNUM;
+		digit_t v = i < num->num_digits ? num->digits[i] / POW10[RNUM - n] : 0;
+		if (v) {
+			for (; v % TEN == 0; v /= TEN) --n;
+			flen = k * RNUM + n;
+			break;
+		}
+	}
+	lay->top = top;
+	lay->flen = flen;
+	lay->neg = num->sign && (top >= 0 || flen);
+	lay->len = lay->neg + (top < 0 ? 1 : (top - ofs) * RNUM + decimal_len(num->digits[top]));
+	if (flen) lay->len += 1 + flen;
+#ifdef DEBUG
+	// '_' after every whole digit and between fractional digits
+	if (top >= 0) lay->len += top - ofs + 1;
+	if (flen) lay->len += (flen + RNUM - 1) / RNUM - 1;
+#endif
+}
+
+/*
+ * Characters are put into buf. For a file, buf is a chunk that is
+ * written out whenever it fills up, else it holds the whole string.
+ */
+#define SINK_CHUNK 4096
+struct sink {
+	char *buf;
+	size_t pos;
+	FILE *file;
+};
+
+/*
+ * Return space for n <= RNUM + 1 characters.
+ */
+static char *sink_room(struct sink *out, int n) {
+	if (out->file && out->pos + n > SINK_CHUNK) {
+		fwrite(out->buf, 1, out->pos, out->file);
+		out->pos = 0;
+	}
+	char *ret = out->buf + out->pos;
+	out->pos += n;
+	return ret;
+}
+
+/*
+ * Put the decimal form of num with layout lay into out.
+ */
+static void format(const struct bignum *num, const struct layout *lay, struct sink *out) {
+	int ofs = num->point_offset;
+	if (lay->neg) *sink_room(out, 1) = MINUS_CHAR;
+	if (lay->top < 0) *sink_room(out, 1) = ZERO_CHAR;
+	for (int i = lay->top; i >= ofs; --i) {
+		// no leading zeroes on the leading digit
+		int n = i == lay->top ? decimal_len(num->digits[i]) : RNUM;
+		write_decimal(sink_room(out, n), num->digits[i], n);
+#ifdef DEBUG
+		*sink_room(out, 1) = '_';
+#endif
+	}
+	if (!lay->flen) return;
+	*sink_room(out, 1) = DOT_CHAR;
+	for (int k = 0; k * RNUM < lay->flen; ++k) {
+		int n = lay->flen - k * RNUM < RNUM ? lay->flen - k * RNUM : RNUM;
+#ifdef DEBUG
+		if (k) *sink_room(out, 1) = '_';
+#endif
+		write_decimal(sink_room(out, n), num->digits[ofs - 1 - k] / POW10[RNUM - n], n);
+	}
+}
+
+/*
+ * Write num as a string into buf, which has room for `size' chars.
+ * At most `precision' digits after point are printed (truncated).
+ * Return the length of the string without '\0'. If size is not larger,
+ * nothing is written; bignum_to_chars(num, NULL, 0) gives the size needed.
+ */
+size_t bignum_to_chars(const struct bignum *num, char *buf, size_t size) {
+	STAT_BEGIN(BIGNUM_STAT_FORMAT, num->num_digits);
+	struct layout lay;
+	layout(num, &lay);
+	if (size > lay.len) {
+		struct sink out = {buf, 0, NULL};
+		format(num, &lay, &out);
+		buf[lay.len] = '\0';
+	}
+	STAT_END();
+	return lay.len;
+}
+
+/*
+ * Write num as a string to file, without building the whole string.
+ * At most `precision' digits after point are printed (truncated).
+ * Return the number of characters written, or -1 on error.
+ */
+int bignum_write(FILE *file, const struct bignum *num) {
+	STAT_BEGIN(BIGNUM_STAT_FORMAT, num->num_digits);
+	struct layout lay;
+	layout(num, &lay);
+	char buf[SINK_CHUNK];
+	struct sink out = {buf, 0, file};
+	format(num, &lay, &out);
+	fwrite(buf, 1, out.pos, file);
+	STAT_END();
+	return ferror(file) ? -1 : (int)lay.len;
+}
+
+/*
+ * Convert bignum to string.
+ * At most `precision' digits after point are printed (truncated).
+ * The string is malloc'd, the caller frees it.
+ * Return NULL on error.
+ */
+char *bignum_to_string(const struct bignum *num) {
+	STAT_BEGIN(BIGNUM_STAT_FORMAT, num->num_digits);
+	struct layout lay;
+	layout(num, &lay);
+	char *ret = malloc(lay.len + 1);
+	if (ret) {
+		struct sink out = {ret, 0, NULL};
+		format(num, &lay, &out);
+		ret[lay.len] = '\0';
+	}
+	STAT_END();
+	return ret;
+}
+
+/*
+ * Binary form of a bignum, for files and for other processes.
+ * A record is a 16 byte header followed by the digits, all little
+ * endian:
+ *
+ *	0	'B' 'N'
+ *	2	version, SER_VERSION
+ *	3	decimal digits per bignum digit (RNUM)
+ *	4	bytes per bignum digit
+ *	5	sign, 0 or 1
+ *	6	2 zero bytes
+ *	8	point_offset, 4 bytes
+ *	12	number of digits n, 4 bytes
+ *	16	the n digits, least significant first
+ *
+ * padded with zero bytes to a multiple of SER_ALIGN, so that records
+ * written one after another keep their digits aligned and a memory
+ * mapped file of them can be read in place. Reading a record is then
+ * little more than a memcpy of its digits. Records are only read by
+ * builds with the same bignum digits.
+ */
+#define SER_VERSION 1
+#define SER_HEADER 16
+#define SER_ALIGN 8
+
+static void put_le(unsigned char *p, unsigned long long x, int n) {
+	for (int i = 0; i < n; ++i, x >>= 8) p[i] = (unsigned char)x;
+}
+
+static unsigned long long get_le(const unsigned char *p, int n) {
+	unsigned long long x = 0;
+	for (int i = n - 1; i >= 0; --i) x = x << 8 | p[i];
+	return x;
+}
+
+static int little_endian(void) {
+	const unsigned one = 1;
+	return *(const unsigned char *)&one;
+}
+
+/*
+ * Size of the record of a bignum of n digits.
+ */
+static size_t ser_size(size_t n) {
+	size_t size = SER_HEADER + n * sizeof(digit_t);
+	return (size + SER_ALIGN - 1) / SER_ALIGN * SER_ALIGN;
+}
+
+/*
+ * Write the record of num into buf, which has room for `size' bytes.
+ * Return the size of the record. If size is smaller, nothing is written;
+ * bignum_serialize(num, NULL, 0) gives the size needed.
+ */
+size_t bignum_serialize(const struct bignum *num, void *buf, size_t size) {
+	// leading zero digits are not written
+	int n = num->num_digits;
+	while (n > num->point_offset && !num->digits[n - 1]) --n;
+	size_t len = ser_size(n);
+	if (size < len) return len;
+	int nonzero = 0;
+	for (int i = 0; i < n && !nonzero; ++i) nonzero = num->digits[i] != 0;
+	unsigned char *p = buf;
+	p[0] = 'B';
+	p[1] = 'N';
+	p[2] = SER_VERSION;
+	p[3] = RNUM;
+	p[4] = sizeof(digit_t);
+	p[5] = num->sign && nonzero;
+	put_le(p + 6, 0, 2);
+	put_le(p + 8, num->point_offset, 4);
+	put_le(p + 12, n, 4);
+	if (little_endian()) {
+		memcpy(p + SER_HEADER, num->digits, n * sizeof(digit_t));
+	} else {
+		for (int i = 0; i < n; ++i) put_le(p + SER_HEADER + i * sizeof(digit_t), num->digits[i], sizeof(digit_t));
+	}
+	memset(p + SER_HEADER + n * sizeof(digit_t), 0, len - SER_HEADER - n * sizeof(digit_t));
+	return len;
+}
+
+/*
+ * Read the record at buf, of at most `size' bytes.
+ * Return the bignum, normalized, and the size of the record in used.
+ * Return NULL if there is no valid record of this build at buf.
+ */
+struct bignum *bignum_deserialize(const void *buf, size_t size, size_t *used) {
+	const unsigned char *p = buf;
+	if (size < SER_HEADER || p[0] != 'B' || p[1] != 'N' || p[2] != SER_VERSION
+			|| p[3] != RNUM || p[4] != sizeof(digit_t) || p[5] > 1 || get_le(p + 6, 2)) {
+		return NULL;
+	}
+	unsigned long long ofs = get_le(p + 8, 4), n = get_le(p + 12, 4);
+	if (n > INT_MAX || ofs > n || ser_size(n) > size) return NULL;
+	struct bignum *ret = bignum_alloc(n);
+	if (little_endian()) {
+		memcpy(ret->digits, p + SER_HEADER, n * sizeof(digit_t));
+	} else {
+		for (int i = 0; i < (int)n; ++i) ret->digits[i] = get_le(p + SER_HEADER + i * sizeof(digit_t), sizeof(digit_t));
+	}
+	for (int i = 0; i < (int)n; ++i) {
+		if (ret->digits[i] >= RADIX) {
+			bignum_free(ret);
+			return NULL;
+		}
+	}
+	ret->sign = p[5];
+	ret->point_offset = ofs;
+	normalize(ret);
+	*used = ser_size(n);
+	return ret;
+}
+
+/*
+ * Low level routines on digit arrays.
+ * Arrays are least significant digit first and carry no point_offset.
+ * Lengths are passed explicitly; leading zeroes are allowed.
+ */
+#define min(x, y) ((x) < (y) ? (x) : (y))
+
+/*
+ * Return x / RADIX and store x % RADIX in *rem, for x < RADIX^2.
+ */
+static inline digit_t div_radix(lldigit_t x, digit_t *rem) {
+#ifdef WIDE_DIGITS
+	// gcc calls a slow library routine for 128 bit division, even by
+	// a constant, so multiply by floor(2^123 / RADIX) and correct instead
+	digit_t q = ((lldigit_t)(digit_t)(x >> 59) * 10633823966279326983ULL) >> 64;
+	lldigit_t r = x - (lldigit_t)q * RADIX;
+	while (r >= RADIX) {
+		++q;
+		r -= RADIX;
+	}
+	*rem = r;
+	return q;
+#else
+	*rem = x % RADIX;
+	return x / RADIX;
+#endif
+}
+
+#ifdef SIMD_DIGITS
+/*
+ * AVX2 kernels on 8 digits at a time.
+ * Digits are below 2^30, so signed 32 bit compares are safe.
+ *
+ * Carries between the lanes of a block are resolved with bit masks:
+ * lane i generates a carry if its sum is >= RADIX and propagates the
+ * incoming one if its sum is exactly RADIX - 1. Adding the generate
+ * mask, shifted up by one and with the carry in at bit 0, to the
+ * propagate mask ripples carries through runs of propagating lanes,
+ * as in binary addition; xor with the propagate mask then leaves the
+ * carry into every lane, and bit 8 is the carry out of the block.
+ */
+
+/*
+ * Spread bits 0..7 of mask over the 8 lanes as 0 or 1.
+ */
+__attribute__((target("avx2")))
+static inline __m256i mask_lanes(unsigned mask) {
+	__m256i bits = _mm256_srlv_epi32(_mm256_set1_epi32(mask), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+	return _mm256_and_si256(bits, _mm256_set1_epi32(1));
+}
+
+__attribute__((target("avx2")))
+static inline unsigned lane_mask(__m256i v) {
+	return _mm256_movemask_ps(_mm256_castsi256_ps(v));
+}
+
+/*
+ * r[0..n) = a[0..n) + b[0..n) for n a multiple of 8.
+ * Return the carry out. r may alias a or b.
+ */
+__attribute__((target("avx2")))
+static digit_t dig_add_avx2(digit_t *r, const digit_t *a, const digit_t *b, int n) {
+	const __m256i radix = _mm256_set1_epi32(RADIX);
+	const __m256i top = _mm256_set1_epi32(RADIX - 1);
+	unsigned carry = 0;
+	for (int i = 0; i < n; i += 8) {
+		__m256i s = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(a + i)),
+			_mm256_loadu_si256((const __m256i *)(b + i)));
+		unsigned g = lane_mask(_mm256_cmpgt_epi32(s, top));
+		unsigned p = lane_mask(_mm256_cmpeq_epi32(s, top));
+		unsigned c = ((g << 1 | carry) + p) ^ p;
+		carry = c >> 8;
+		s = _mm256_add_epi32(s, mask_lanes(c));
+		// subtract RADIX where s >= RADIX, otherwise s - RADIX wraps above s
+		s = _mm256_min_epu32(s, _mm256_sub_epi32(s, radix));
+		_mm256_storeu_si256((__m256i *)(r + i), s);
+	}
+	return carry;
+}
+
+/*
+ * r[0..n) = a[0..n) - b[0..n) for n a multiple of 8.
+ * Return the borrow out. r may alias a or b.
+ * Borrows are resolved like carries, lanes with a < b generate one and
+ * lanes with a == b propagate it.
+ */
+__attribute__((target("avx2")))
+static digit_t dig_sub_avx2(digit_t *r, const digit_t *a, const digit_t *b, int n) {
+	const __m256i radix = _mm256_set1_epi32(RADIX);
+	unsigned borrow = 0;
+	for (int i = 0; i < n; i += 8) {
+		__m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+		__m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+		unsigned g = lane_mask(_mm256_cmpgt_epi32(vb, va));
+		unsigned p = lane_mask(_mm256_cmpeq_epi32(va, vb));
+		unsigned c = ((g << 1 | borrow) + p) ^ p;
+		borrow = c >> 8;
+		__m256i d = _mm256_sub_epi32(_mm256_sub_epi32(va, vb), mask_lanes(c));
+		// add RADIX where the difference wrapped below 0
+		d = _mm256_min_epu32(d, _mm256_add_epi32(d, radix));
+		_mm256_storeu_si256((__m256i *)(r + i), d);
+	}
+	return borrow;
+}
+
+/*
+ * Return the highest i < n with a[i] != b[i], or -1.
+ */
+__attribute__((target("avx2")))
+static int dig_diff_avx2(const digit_t *a, const digit_t *b, int n) {
+	int i = n;
+	for (; i >= 8; i -= 8) {
+		__m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(a + i - 8)),
+			_mm256_loadu_si256((const __m256i *)(b + i - 8)));
+		unsigned m = ~lane_mask(eq) & 0xFF;
+		if (m) return i - 8 + 31 - __builtin_clz(m);
+	}
+	while (--i >= 0 && a[i] == b[i]);
+	return i;
+}
+
+// kernels pay off from this many digits
+#define SIMD_MIN 8
+#endif
+
+/*
+ * Number of digits in a[0..n) ignoring leading zeroes.
+ */
+static int dig_len(const digit_t *a, int n) {
+	while (n > 0 && !a[n - 1]) --n;
+	return n;
+}
+
+/*
+ * Compare a[0..n) with b[0..n).
+ * Return -ve, 0 or +ve like mag_comp.
+ */
+static int dig_cmp(const digit_t *a, const digit_t *b, int n) {
+#ifdef SIMD_DIGITS
+	if (n >= SIMD_MIN && __builtin_cpu_supports("avx2")) {
+		int i = dig_diff_avx2(a, b, n);
+		if (i < 0) return 0;
+		return a[i] < b[i] ? -1 : 1;
+	}
+#endif
+	for (int i = n - 1; i >= 0; --i) {
+		if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+	}
+	return 0;
+}
+
+/*
+ * r[0..an) = a[0..an) + b[0..bn), an >= bn.
+ * Return the carry out of the top digit.
+ * r may alias a or b.
+ */
+static digit_t dig_add(digit_t *r, const digit_t *a, int an, const digit_t *b, int bn) {
+	digit_t carry = 0;
+	int i = 0;
+#ifdef SIMD_DIGITS
+	if (bn >= SIMD_MIN && __builtin_cpu_supports("avx2")) {
+		i = bn & ~7;
+		carry = dig_add_avx2(r, a, b, i);
+	}
+#endif
+	for (; i < bn; ++i) {
+		digit_t tmp = a[i] + b[i] + carry;
+		carry = tmp >= RADIX;
+		r[i] = carry ? tmp - RADIX : tmp;
+	}
+	for (; i < an; ++i) {
+		digit_t tmp = a[i] + carry;
+		carry = tmp >= RADIX;
+		r[i] = carry ? tmp - RADIX : tmp;
+	}
+	return carry;
+}
+
+/*
+ * r[0..an) = a[0..an) - b[0..bn), an >= bn.
+ * Return the borrow out of the top digit.
+ * r may alias a or b.
+ */
+static digit_t dig_sub(digit_t *r, const digit_t *a, int an, const digit_t *b, int bn) {
+	digit_t borrow = 0;
+	int i = 0;
+#ifdef SIMD_DIGITS
+	if (bn >= SIMD_MIN && __builtin_cpu_supports("avx2")) {
+		i = bn & ~7;
+		borrow = dig_sub_avx2(r, a, b, i);
+	}
+#endif
+	for (; i < bn; ++i) {
+		digit_t sub = b[i] + borrow;
+		borrow = a[i] < sub;
+		r[i] = borrow ? a[i] + RADIX - sub : a[i] - sub;
+	}
+	for (; i < an; ++i) {
+		digit_t sub = borrow;
+		borrow = a[i] < sub;
+		r[i] = borrow ? a[i] + RADIX - sub : a[i] - sub;
+	}
+	return borrow;
+}
+
+/*
+ * r[0..rn) += a[0..an), propagating the carry up to r[rn - 1].
+ * Digits of a at or beyond rn must be zero.
+ */
+static void dig_add_into(digit_t *r, int rn, const digit_t *a, int an) {
+	int n = min(an, rn);
+	if (dig_add(r, r, n, a, n)) {
+		for (int i = n; i < rn && ++r[i] == RADIX; ++i) r[i] = 0;
+	}
+}
+
+/*
+ * r[0..rn) -= a[0..an), propagating the borrow up to r[rn - 1].
+ * Use only when the result is non-negative.
+ */
+static void dig_sub_into(digit_t *r, int rn, const digit_t *a, int an) {
+	int n = min(an, rn);
+	if (dig_sub(r, r, n, a, n)) {
+		for (int i = n; i < rn && r[i]-- == 0; ++i) r[i] = RADIX - 1;
+	}
+}
+
+/*
+ * Signed addition of magnitudes of length n.
+ * r = (-1)^sa * a + (-1)^sb * b, return the sign of r.
+ * The result must fit in n digits. r may alias a or b.
+ */
+static int dig_addsub_n(digit_t *r, const digit_t *a, int sa, const digit_t *b, int sb, int n) {
+	if (sa == sb) {
+		dig_add(r, a, n, b, n);
+		return sa;
+	}
+	if (dig_cmp(a, b, n) >= 0) {
+		dig_sub(r, a, n, b, n);
+		return sa;
+	}
+	dig_sub(r, b, n, a, n);
+	return sb;
+}
+
+/*
+ * a[0..n) /= d, where d is small and divides a exactly.
+ */
+static void dig_divexact_1(digit_t *a, int n, digit_t d) {
+	lldigit_t rem = 0;
+	for (int i = n - 1; i >= 0; --i) {
+		rem = rem * RADIX + a[i];
+		a[i] = rem / d;
+		rem %= d;
+	}
+}
+
+/*
+ * Return -ve if |a| < |b|, 0 if |a| == |b|, +ve if |a| > |b|.
+ * Digits are aligned at the point and compared from the top, so the
+ * shared part is one dig_cmp.
+ */
+int mag_comp(const struct bignum *a, const struct bignum *b) {
+	// do not compare sizes, as leading digits may be zero
+	int an = dig_len(a->digits, a->num_digits);
+	int bn = dig_len(b->digits, b->num_digits);
+	if (!an || !bn) return an - bn;
+	// position of the leading digit relative to the point
+	int at = an - a->point_offset, bt = bn - b->point_offset;
+	if (at != bt) return at < bt ? -1 : 1;
+	// both have digits from the top down to here
+	int n = min(an, bn);
+	int cmp = dig_cmp(a->digits + an - n, b->digits + bn - n, n);
+	if (cmp) return cmp;
+	// the longer one is larger if it has non-zero digits further down
+	if (an > n) return dig_len(a->digits, an - n) ? 1 : 0;
+	if (bn > n) return dig_len(b->digits, bn - n) ? -1 : 0;
+	return 0;
+}
+
+/*
+ * dst = |a| + |b| with the resulting point_offset, sign is left to the caller.
+ * dst may be a or b only if that operand has the resulting point_offset.
+ */
+static void add_unsigned(struct bignum *dst, const struct bignum *a, const struct bignum *b) {
+	if (dst == b) {
+		// addition commutes, make dst the first operand
+		b = a;
+		a = dst;
+	}
+	int rofs = max(a->point_offset, b->point_offset); // resulting point offset
+	// resulting number of digits in whole number part
+	int rwnd = 1 + max(a->num_digits - a->point_offset, b->num_digits - b->point_offset);
+	// sizes before dst is resized, as dst may be a or b
+	int an = a->num_digits, bn = b->num_digits;
+	int bs = rofs - b->point_offset; // position of b in the result
+	if (dst == a) {
+		bignum_resize(dst, rwnd + rofs);
+		memset(dst->digits + an, 0, (rwnd + rofs - an) * sizeof(digit_t));
+	} else {
+		bignum_resize(dst, rwnd + rofs);
+		memset(dst->digits, 0, (rwnd + rofs) * sizeof(digit_t));
+		memcpy(dst->digits + rofs - a->point_offset, a->digits, an * sizeof(digit_t));
+	}
+	dst->point_offset = rofs;
+	// the extra whole digit takes the last carry
+	dig_add_into(dst->digits + bs, rwnd + rofs - bs, b->digits, bn);
+}
+
+/*
+ * dst = |a| - |b| with the resulting point_offset, sign is left to the caller.
+ * Use only for |a| >= |b|.
+ * dst may be a only if a has the resulting point_offset, and not b.
+ */
+static void sub_unsigned(struct bignum *dst, const struct bignum *a, const struct bignum *b) {
+	int rofs = max(a->point_offset, b->point_offset); // resulting point offset
+	// resulting number of digits in whole number part, assuming a >= b
+	int rwnd = a->num_digits - a->point_offset;
+	int bn = b->num_digits;
+	int bs = rofs - b->point_offset; // position of b in the result
+	if (dst != a) {
+		bignum_resize(dst, rwnd + rofs);
+		memset(dst->digits, 0, (rwnd + rofs) * sizeof(digit_t));
+		memcpy(dst->digits + rofs - a->point_offset, a->digits, a->num_digits * sizeof(digit_t));
+	}
+	dst->point_offset = rofs;
+	// digits of b beyond the result can only be leading zeroes
+	dig_sub_into(dst->digits + bs, rwnd + rofs - bs, b->digits, bn);
+}
+
+/*
+ * dst = a + b if `sub' = 0, dst = a - b if `sub' = 1 (signed).
+ * dst may alias a or b.
+ */
+static void addsub_into(struct bignum *dst, const struct bignum *a, const struct bignum *b, int sub) {
+	STAT_BEGIN(sub ? BIGNUM_STAT_SUB : BIGNUM_STAT_ADD, a->num_digits + b->num_digits);
+	int sa = a->sign;
+	int sb = b->sign ^ sub;
+	int sign = sa;
+	if (sa != sb && mag_comp(a, b) <= 0) {
+		// subtract the smaller magnitude from the larger
+		const struct bignum *t = a;
+		a = b;
+		b = t;
+		sign = sb;
+	}
+	int rofs = max(a->point_offset, b->point_offset);
+	// dst can be updated in place only if it is not shifted,
+	// and, for subtraction, only if it is the first operand
+	int tmp_needed = (dst == a && a->point_offset != rofs)
+		|| (dst == b && (b->point_offset != rofs || (sa != sb && dst != a)));
+	struct bignum tmp;
+	bignum_init(&tmp, dst->arena);
+	struct bignum *r = tmp_needed ? &tmp : dst;
+	if (sa == sb) add_unsigned(r, a, b);
+	else sub_unsigned(r, a, b);
+	if (tmp_needed) bignum_take(dst, &tmp);
+	dst->sign = sign;
+	STAT_END();
+}
+
+/*
+ * dst = a + b (signed), reusing the digits of dst.
+ * dst may alias a or b.
+ */
+void bignum_add_into(struct bignum *dst, const struct bignum *a, const struct bignum *b) {
+	addsub_into(dst, a, b, 0);
+	normalize_prec(dst);
+}
+
+/*
+ * dst = a - b (signed), reusing the digits of dst.
+ * dst may alias a or b.
+ */
+void bignum_sub_into(struct bignum *dst, const struct bignum *a, const struct bignum *b) {
+	addsub_into(dst, a, b, 1);
+	normalize_prec(dst);
+}
+
+/*
+ * Signed add if `sub' = 0, signed sub if `sub' = 1.
+ */
+struct bignum *addsub_signed(const struct bignum *a, const struct bignum *b, int sub) {
+	struct bignum *ret = bignum_new();
+	addsub_into(ret, a, b, sub);
+	normalize_prec(ret);
+	return ret;
+}
+
+/* Operand sizes (in bignum digits) above which faster algorithms are used */
+#ifdef WIDE_DIGITS
+#define KARATSUBA_THRESHOLD 16
+#define TOOM3_THRESHOLD 80
+#else
+#define KARATSUBA_THRESHOLD 32
+#define TOOM3_THRESHOLD 160
+#endif
+
+/*
+ * Multithreading of huge multiplications.
+ * The independent parts of a product (the sub-products of Karatsuba and
+ * Toom-3, the transforms of the NTT and the butterflies within one) run
+ * on threads of their own and are joined before they are combined.
+ * Every thread has a budget of threads in par_threads, which it shares
+ * out among the parts it starts. Operands shorter than par_min digits
+ * are multiplied on the calling thread alone.
+ * Set with bignum_set_threads or the environment variables
+ * BIGNUM_THREADS and BIGNUM_THREADS_MIN_DIGITS; one thread by default.
+ */
+#define PAR_MIN_DIGITS 50000 // default, in decimal digits
+static int par_max = 1; // budget of a thread outside a multiplication
+static int par_min = (PAR_MIN_DIGITS + RNUM - 1) / RNUM;
+static _Thread_local int par_threads; // budget, 0 for par_max
+static pthread_once_t par_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Number of threads to use for `threads' <= 0.
+ */
+static int par_online(void) {
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (int)n : 1;
+}
+
+static void par_init(void) {
+	const char *env = getenv("BIGNUM_THREADS");
+	if (env) par_max = atoi(env) > 0 ? atoi(env) : par_online();
+	env = getenv("BIGNUM_THREADS_MIN_DIGITS");
+	if (env && atoi(env) >= 0) par_min = (atoi(env) + RNUM - 1) / RNUM;
+}
+
+/*
+ * Use up to `threads' threads for each multiplication whose operands
+ * have at least `min_digits' decimal digits; threads = 0 means one per
+ * online processor. Meant to be called before any computation starts.
+ * Return 0, or -1 if threads or min_digits is negative.
+ */
+int bignum_set_threads(int threads, int min_digits) {
+	if (threads < 0 || min_digits < 0) return -1;
+	pthread_once(&par_once, par_init);
+	par_max = threads ? threads : par_online();
+	par_min = (min_digits + RNUM - 1) / RNUM;
+	return 0;
+}
+
+/*
+ * Threads to use for a part with operands of n bignum digits.
+ */
+static int par_budget(int n) {
+	if (!par_threads) pthread_once(&par_once, par_init);
+	if (n < par_min) return 1;
+	return par_threads ? par_threads : par_max;
+}
+
+/*
+ * A part of a computation that may run on a thread of its own.
+ */
+struct par_job {
+	void (*run)(void *arg);
+	void *arg;
+};
+
+/*
+ * Jobs first, first + step, ... of jobs[0..n), run in turn by one thread
+ * with a budget of `threads'.
+ */
+struct par_group {
+	struct par_job *jobs;
+	int first, step, n;
+	int threads;
+	int started; // runs on a thread of its own
+	pthread_t thread;
+};
+
+static void *par_group_run(void *arg) {
+	struct par_group *g = arg;
+	int saved = par_threads;
+	par_threads = g->threads;
+	for (int i = g->first; i < g->n; i += g->step) g->jobs[i].run(g->jobs[i].arg);
+	par_threads = saved;
+	return NULL;
+}
+
+/*
+ * Run jobs[0..n) on up to `threads' threads including this one.
+ * The jobs are dealt out to the threads in turn, and the budget is
+ * split among the threads. Jobs of a thread that cannot be started
+ * run on this one.
+ */
+static void par_run(struct par_job *jobs, int n, int threads) {
+	int groups = threads < n ? threads : n;
+	struct par_group *g = malloc(groups * sizeof(struct par_group));
+	if (!g) exit(EXIT_FAILURE);
+	for (int i = 0; i < groups; ++i) {
+		g[i].jobs = jobs;
+		g[i].first = i;
+		g[i].step = groups;
+		g[i].n = n;
+		g[i].threads = threads / groups + (i < threads % groups);
+		g[i].started = i && !pthread_create(&g[i].thread, NULL, par_group_run, &g[i]);
+	}
+	for (int i = 0; i < groups; ++i) {
+		if (!g[i].started) par_group_run(&g[i]);
+	}
+	for (int i = 1; i < groups; ++i) {
+		if (g[i].started) pthread_join(g[i].thread, NULL);
+	}
+	free(g);
+}
+
+/*
+ * A product r[0..an+bn) = a[0..an) * b[0..bn) as a job.
+ */
+struct mul_job {
+	digit_t *r;
+	const digit_t *a, *b;
+	int an, bn;
+};
+
+static void dig_mul(digit_t *r, const digit_t *a, int an, const digit_t *b, int bn);
+static void mul_job_run(void *arg) {
+	struct mul_job *m = arg;
+	dig_mul(m->r, m->a, m->an, m->b, m->bn);
+}
+
+/*
+ * Compute the products of muls[0..n) on up to `threads' threads.
+ */
+static void par_mul(struct mul_job *muls, int n, int threads) {
+	struct par_job jobs[8];
+	for (int i = 0; i < n; ++i) {
+		jobs[i].run = mul_job_run;
+		jobs[i].arg = &muls[i];
+	}
+	par_run(jobs, n, threads);
+}
+
+static void dig_mul_n(digit_t *r, const digit_t *a, const digit_t *b, int n);
+
+/*
+ * r[0..an+bn) = a[0..an) * b[0..bn).
+ * Schoolbook long multiplication, any operand sizes.
+ */
+static void mul_basecase(digit_t *r, const digit_t *a, int an, const digit_t *b, int bn) {
+	memset(r, 0, (an + bn) * sizeof(digit_t));
+	for (int bi = 0; bi < bn; ++bi) {
+		digit_t carry = 0;
+		for (int ai = 0; ai < an; ++ai) {
+			lldigit_t tmp = (lldigit_t)a[ai] * b[bi];
+			tmp += r[ai + bi] + carry;
+			carry = div_radix(tmp, &r[ai + bi]);
+		}
+		r[an + bi] = carry;
+	}
+}
+
+/*
+ * r[0..2n) = a[0..n)^2.
+ * Schoolbook squaring: every product a[i] a[j], i < j, is formed once
+ * and doubled, then the squares a[i]^2 are added on the diagonal, so
+ * about half the digit products of mul_basecase are made.
+ */
+static void sqr_basecase(digit_t *r, const digit_t *a, int n) {
+	memset(r, 0, 2 * n * sizeof(digit_t));
+	for (int i = 0; i < n - 1; ++i) {
+		digit_t carry = 0;
+		for (int j = i + 1; j < n; ++j) {
+			lldigit_t tmp = (lldigit_t)a[i] * a[j];
+			tmp += r[i + j] + carry;
+			carry = div_radix(tmp, &r[i + j]);
+		}
+		r[i + n] = carry;
+	}
+	dig_add(r, r, 2 * n, r, 2 * n); // cannot carry out, the square fits
+	digit_t carry = 0;
+	for (int i = 0; i < n; ++i) {
+		lldigit_t tmp = (lldigit_t)a[i] * a[i];
+		tmp += r[2 * i] + carry;
+		carry = div_radix(tmp, &r[2 * i]);
+		tmp = (lldigit_t)r[2 * i + 1] + carry;
+		carry = div_radix(tmp, &r[2 * i + 1]);
+	}
+}
+
+/*
+ * r[0..2n) = a[0..n) * b[0..n).
+ * Karatsuba: three half size products instead of four.
+ * For a == b the three products are squares.
+ */
+static void mul_karatsuba(digit_t *r, const digit_t *a, const digit_t *b, int n) {
+	int m = (n + 1) / 2; // size of low halves
+	int k = n - m; // size of high halves, k <= m
+	digit_t *tmp = malloc((4 * m + 4) * sizeof(digit_t));
+	if (!tmp) exit(EXIT_FAILURE);
+	digit_t *sa = tmp, *sb = tmp + m + 1, *mid = tmp + 2 * m + 2;
+	sa[m] = dig_add(sa, a, m, a + m, k);
+	if (a == b) sb = sa;
+	else sb[m] = dig_add(sb, b, m, b + m, k);
+	int threads = par_budget(n);
+	if (threads > 1) {
+		struct mul_job muls[3] = {
+			{r, a, b, m, m},
+			{r + 2 * m, a + m, b + m, k, k},
+			{mid, sa, sb, m + 1, m + 1}
+		};
+		par_mul(muls, 3, threads);
+	} else {
+		dig_mul_n(r, a, b, m); // low product
+		dig_mul_n(r + 2 * m, a + m, b + m, k); // high product
+		dig_mul_n(mid, sa, sb, m + 1); // (a0 + a1) * (b0 + b1)
+	}
+	dig_sub_into(mid, 2 * m + 2, r, 2 * m);
+	dig_sub_into(mid, 2 * m + 2, r + 2 * m, 2 * k);
+	dig_add_into(r + m, 2 * n - m, mid, 2 * m + 2);
+	free(tmp);
+}
+
+/*
+ * Evaluate the 3-way split a = a0 + a1 x + a2 x^2 at 1, -1 and -2.
+ * a0, a1 have k digits, a2 has k2 digits, results have k + 1 digits.
+ * pad is scratch space of k + 1 digits.
+ */
+static void toom3_eval(digit_t *v1, digit_t *vm1, int *sm1, digit_t *vm2, int *sm2,
+		const digit_t *a, int k, int k2, digit_t *pad) {
+	int l = k + 1;
+	memset(v1, 0, l * sizeof(digit_t));
+	memset(vm2, 0, l * sizeof(digit_t));
+	memset(pad, 0, l * sizeof(digit_t));
+	memcpy(v1, a, k * sizeof(digit_t));
+	dig_add_into(v1, l, a + 2 * k, k2); // a0 + a2
+	memcpy(pad, a + k, k * sizeof(digit_t));
+	*sm1 = dig_addsub_n(vm1, v1, 0, pad, 1, l); // a0 - a1 + a2
+	dig_add(v1, v1, l, pad, l); // a0 + a1 + a2
+	memcpy(vm2, a + 2 * k, k2 * sizeof(digit_t));
+	*sm2 = dig_addsub_n(vm2, vm1, *sm1, vm2, 0, l); // a0 - a1 + 2 a2
+	*sm2 = dig_addsub_n(vm2, vm2, *sm2, vm2, *sm2, l); // 2 a0 - 2 a1 + 4 a2
+	memcpy(pad, a, k * sizeof(digit_t));
+	*sm2 = dig_addsub_n(vm2, vm2, *sm2, pad, 1, l); // a0 - 2 a1 + 4 a2
+}
+
+/*
+ * r[0..2n) = a[0..n) * b[0..n).
+ * Toom-3: five third size products, evaluated at 0, 1, -1, -2 and infinity
+ * and interpolated with Bodrato's sequence.
+ * For a == b the operand is evaluated once and the products are squares.
+ */
+static void mul_toom3(digit_t *r, const digit_t *a, const digit_t *b, int n) {
+	int k = (n + 2) / 3; // size of a0, a1
+	int k2 = n - 2 * k; // size of a2
+	int l = k + 1; // size of evaluated operands
+	int w = 2 * l; // size of evaluated products
+	digit_t *tmp = malloc((7 * l + 5 * w) * sizeof(digit_t));
+	if (!tmp) exit(EXIT_FAILURE);
+	digit_t *a1 = tmp, *am1 = a1 + l, *am2 = am1 + l;
+	digit_t *b1 = am2 + l, *bm1 = b1 + l, *bm2 = bm1 + l;
+	digit_t *pad = bm2 + l;
+	digit_t *r1 = pad + l, *rm1 = r1 + w, *rm2 = rm1 + w, *r0 = rm2 + w, *r4 = r0 + w;
+	int sam1, sam2, sbm1, sbm2;
+	toom3_eval(a1, am1, &sam1, am2, &sam2, a, k, k2, pad);
+	if (a == b) {
+		b1 = a1, bm1 = am1, bm2 = am2;
+		sbm1 = sam1, sbm2 = sam2;
+	} else {
+		toom3_eval(b1, bm1, &sbm1, bm2, &sbm2, b, k, k2, pad);
+	}
+
+	// products at 0 and infinity go directly to their final place
+	int threads = par_budget(n);
+	if (threads > 1) {
+		struct mul_job muls[5] = {
+			{r1, a1, b1, l, l},
+			{rm1, am1, bm1, l, l},
+			{rm2, am2, bm2, l, l},
+			{r, a, b, k, k},
+			{r + 4 * k, a + 2 * k, b + 2 * k, k2, k2}
+		};
+		par_mul(muls, 5, threads);
+	} else {
+		dig_mul_n(r1, a1, b1, l);
+		dig_mul_n(rm1, am1, bm1, l);
+		dig_mul_n(rm2, am2, bm2, l);
+		dig_mul_n(r, a, b, k);
+		dig_mul(r + 4 * k, a + 2 * k, k2, b + 2 * k, k2);
+	}
+	int s1 = 0, sm1 = sam1 ^ sbm1, sm2 = sam2 ^ sbm2;
+	memset(r0, 0, 2 * w * sizeof(digit_t));
+	memcpy(r0, r, 2 * k * sizeof(digit_t));
+	memcpy(r4, r + 4 * k, 2 * k2 * sizeof(digit_t));
+	memset(r + 2 * k, 0, 2 * k * sizeof(digit_t));
+
+	// interpolate, rm2 becomes r3 and rm1 becomes r2
+	sm2 = dig_addsub_n(rm2, rm2, sm2, r1, 1, w);
+	dig_divexact_1(rm2, w, 3);
+	s1 = dig_addsub_n(r1, r1, s1, rm1, !sm1, w);
+	dig_divexact_1(r1, w, 2);
+	sm1 = dig_addsub_n(rm1, rm1, sm1, r0, 1, w);
+	sm2 = dig_addsub_n(rm2, rm1, sm1, rm2, !sm2, w);
+	dig_divexact_1(rm2, w, 2);
+	sm2 = dig_addsub_n(rm2, rm2, sm2, r4, 0, w);
+	sm2 = dig_addsub_n(rm2, rm2, sm2, r4, 0, w);
+	sm1 = dig_addsub_n(rm1, rm1, sm1, r1, s1, w);
+	sm1 = dig_addsub_n(rm1, rm1, sm1, r4, 1, w);
+	dig_addsub_n(r1, r1, s1, rm2, !sm2, w);
+
+	// all coefficients are non-negative now
+	dig_add_into(r + k, 2 * n - k, r1, w);
+	dig_add_into(r + 2 * k, 2 * n - 2 * k, rm1, w);
+	dig_add_into(r + 3 * k, 2 * n - 3 * k, rm2, w);
+	free(tmp);
+}
+
+/*
+ * Number theoretic transforms modulo three primes p = c * 2^k + 1,
+ * all with primitive root 3. The convolution is recombined exactly
+ * with the Chinese remainder theorem, so no rounding is involved.
+ * Each coefficient of the convolution is below min(an, bn) * RADIX^2,
+ * far less than the product of the primes for any supported size.
+ * Residues are multiplied in Montgomery form with R = 2^32.
+ */
+__extension__ typedef unsigned __int128 ntt_wide_t;
+struct ntt_prime {
+	unsigned p; // the prime
+	unsigned pinv; // -p^-1 mod 2^32
+	unsigned r2; // 2^64 mod p
+};
+#define NTT_G 3
+#define NTT_PRIMES 3
+static const unsigned NTT_P[NTT_PRIMES] = {
+	998244353, // 119 * 2^23 + 1
+	167772161, // 5 * 2^25 + 1
+	469762049 // 7 * 2^26 + 1
+};
+// largest transform size supported by all three primes
+#define NTT_MAX_SIZE (1 << 23)
+// wide digits are split in two for the transform
+#if RADIX > 1000000000
+#define NTT_SPLIT 2
+#define NTT_BASE 1000000000
+#else
+#define NTT_SPLIT 1
+#define NTT_BASE RADIX
+#endif
+// operand size (in bignum digits) above which ntt is used
+#define NTT_THRESHOLD (800 / NTT_SPLIT)
+
+static void ntt_prime_init(struct ntt_prime *np, unsigned p) {
+	unsigned inv = p; // p^-1 mod 2^32 by Newton iteration
+	for (int i = 0; i < 5; ++i) inv *= 2 - p * inv;
+	np->p = p;
+	np->pinv = -inv;
+	unsigned long long r = (1ULL << 32) % p;
+	np->r2 = r * r % p;
+}
+
+/*
+ * Montgomery product a * b * 2^-32 mod p, for a, b < p.
+ */
+static inline unsigned ntt_mul(const struct ntt_prime *np, unsigned a, unsigned b) {
+	unsigned long long t = (unsigned long long)a * b;
+	unsigned m = (unsigned)t * np->pinv;
+	unsigned u = (t + (unsigned long long)m * np->p) >> 32;
+	return u >= np->p ? u - np->p : u;
+}
+
+static inline unsigned ntt_pow(const struct ntt_prime *np, unsigned long long b, unsigned long long e) {
+	unsigned long long r = 1;
+	b %= np->p;
+	for (; e; e >>= 1) {
+		if (e & 1) r = r * b % np->p;
+		b = b * b % np->p;
+	}
+	return r;
+}
+
+/*
+ * Fill w[len + j] = (root of unity of order 2 * len)^j for every
+ * power of two len < n, in Montgomery form so that ntt_mul(x, w)
+ * is the ordinary product x * w mod p.
+ */
+static void ntt_roots(const struct ntt_prime *np, unsigned *w, int n, int inverse) {
+	for (int len = 1; len < n; len <<= 1) {
+		unsigned long long z = ntt_pow(np, NTT_G, (np->p - 1) / (2 * len));
+		if (inverse) z = ntt_pow(np, z, np->p - 2);
+		unsigned long long x = 1;
+		for (int j = 0; j < len; ++j) {
+			w[len + j] = ntt_mul(np, x, np->r2);
+			x = x * z % np->p;
+		}
+	}
+}
+
+/*
+ * Butterflies of the forward (decimation in frequency) and inverse
+ * (decimation in time) transforms on x = a[i + j], y = a[i + j + len]
+ * with root w = w[len + j].
+ */
+static inline void ntt_dif(const struct ntt_prime *np, unsigned *x, unsigned *y, unsigned w) {
+	unsigned p = np->p, u = *x, v = *y;
+	*x = u + v >= p ? u + v - p : u + v;
+	*y = ntt_mul(np, u + p - v, w);
+}
+
+static inline void ntt_dit(const struct ntt_prime *np, unsigned *x, unsigned *y, unsigned w) {
+	unsigned p = np->p, u = *x, v = ntt_mul(np, *y, w);
+	*x = u + v >= p ? u + v - p : u + v;
+	*y = u >= v ? u - v : u + p - v;
+}
+
+/*
+ * Forward transform, decimation in frequency.
+ * Natural order in, bit reversed order out.
+ */
+static void ntt_forward(const struct ntt_prime *np, unsigned *a, int n, const unsigned *w) {
+	for (int len = n / 2; len >= 1; len >>= 1) {
+		for (int i = 0; i < n; i += 2 * len) {
+			for (int j = 0; j < len; ++j) {
+				ntt_dif(np, &a[i + j], &a[i + j + len], w[len + j]);
+			}
+		}
+	}
+}
+
+/*
+ * Inverse transform without the 1/n scaling, decimation in time.
+ * Bit reversed order in, natural order out.
+ */
+static void ntt_inverse(const struct ntt_prime *np, unsigned *a, int n, const unsigned *w) {
+	for (int len = 1; len < n; len <<= 1) {
+		for (int i = 0; i < n; i += 2 * len) {
+			for (int j = 0; j < len; ++j) {
+				ntt_dit(np, &a[i + j], &a[i + j + len], w[len + j]);
+			}
+		}
+	}
+}
+
+/*
+ * Part of a transform on its own thread: butterflies [lo, hi) of the
+ * stage `len', or the whole transforms of blocks [lo, hi) of size n.
+ */
+struct ntt_job {
+	const struct ntt_prime *np;
+	unsigned *a;
+	const unsigned *w;
+	int n, len;
+	int lo, hi;
+	int inverse;
+};
+
+static void ntt_stage_run(void *arg) {
+	struct ntt_job *t = arg;
+	for (int b = t->lo; b < t->hi; ++b) {
+		int i = b / t->len * 2 * t->len, j = b % t->len;
+		if (t->inverse) ntt_dit(t->np, &t->a[i + j], &t->a[i + j + t->len], t->w[t->len + j]);
+		else ntt_dif(t->np, &t->a[i + j], &t->a[i + j + t->len], t->w[t->len + j]);
+	}
+}
+
+static void ntt_blocks_run(void *arg) {
+	struct ntt_job *t = arg;
+	for (int b = t->lo; b < t->hi; ++b) {
+		if (t->inverse) ntt_inverse(t->np, t->a + (size_t)b * t->n, t->n, t->w);
+		else ntt_forward(t->np, t->a + (size_t)b * t->n, t->n, t->w);
+	}
+}
+
+/*
+ * Run `len' stage of a transform of size n, or the transforms of its
+ * blocks of size m if len = 0, split among `threads' threads.
+ */
+static void ntt_par_step(const struct ntt_prime *np, unsigned *a, int n, const unsigned *w,
+		int inverse, int len, int m, int threads) {
+	struct ntt_job *t = malloc(threads * sizeof(struct ntt_job));
+	struct par_job *jobs = malloc(threads * sizeof(struct par_job));
+	if (!t || !jobs) exit(EXIT_FAILURE);
+	int count = len ? n / 2 : n / m; // butterflies or blocks
+	for (int k = 0; k < threads; ++k) {
+		struct ntt_job job = {np, a, w, m, len, (long long)count * k / threads,
+			(long long)count * (k + 1) / threads, inverse};
+		t[k] = job;
+		jobs[k].run = len ? ntt_stage_run : ntt_blocks_run;
+		jobs[k].arg = &t[k];
+	}
+	par_run(jobs, threads, threads);
+	free(jobs);
+	free(t);
+}
+
+/*
+ * ntt_forward or ntt_inverse on up to `threads' threads.
+ * Once blocks of size m are at least as many as the threads, they are
+ * independent transforms and are dealt out to the threads; the stages
+ * above that have their butterflies split among the threads.
+ */
+static void ntt_transform(const struct ntt_prime *np, unsigned *a, int n, const unsigned *w,
+		int inverse, int threads) {
+	if (threads <= 1) {
+		if (inverse) ntt_inverse(np, a, n, w);
+		else ntt_forward(np, a, n, w);
+		return;
+	}
+	int m = n;
+	while (m > 2 && n / m < threads) m >>= 1;
+	if (!inverse) {
+		for (int len = n / 2; len >= m; len >>= 1) ntt_par_step(np, a, n, w, 0, len, m, threads);
+		ntt_par_step(np, a, n, w, 0, 0, m, threads);
+	} else {
+		ntt_par_step(np, a, n, w, 1, 0, m, threads);
+		for (int len = m; len < n; len <<= 1) ntt_par_step(np, a, n, w, 1, len, m, threads);
+	}
+}
+
+/*
+ * Cyclic convolution of a[0..an) and b[0..bn) modulo np->p,
+ * written to c[0..n), on up to `threads' threads.
+ * tmp is scratch space of 2 * n words.
+ * For a == b only one forward transform is made.
+ */
+static void ntt_convolve(const struct ntt_prime *np, unsigned *c, int n,
+		const unsigned *a, int an, const unsigned *b, int bn, unsigned *tmp, int threads) {
+	unsigned *w = tmp, *fb = tmp + n;
+	int sqr = a == b && an == bn;
+	for (int i = 0; i < n; ++i) c[i] = i < an ? a[i] % np->p : 0;
+	ntt_roots(np, w, n, 0);
+	ntt_transform(np, c, n, w, 0, threads);
+	if (sqr) {
+		fb = c;
+	} else {
+		for (int i = 0; i < n; ++i) fb[i] = i < bn ? b[i] % np->p : 0;
+		ntt_transform(np, fb, n, w, 0, threads);
+	}
+	// pointwise products lose a factor 2^32, restored by the scaling below
+	for (int i = 0; i < n; ++i) c[i] = ntt_mul(np, c[i], fb[i]);
+	ntt_roots(np, w, n, 1);
+	ntt_transform(np, c, n, w, 1, threads);
+	// multiply by 2^32 / n, in Montgomery form
+	unsigned scale = ntt_mul(np, ntt_pow(np, n, np->p - 2), np->r2);
+	scale = ntt_mul(np, scale, np->r2);
+	for (int i = 0; i < n; ++i) c[i] = ntt_mul(np, c[i], scale);
+}
+
+/*
+ * f[0..NTT_SPLIT * n) = coefficients of a[0..n) in base NTT_BASE.
+ */
+static void ntt_split(unsigned *f, const digit_t *a, int n) {
+	for (int i = 0; i < n; ++i) {
+#if NTT_SPLIT == 2
+		f[2 * i] = a[i] % NTT_BASE;
+		f[2 * i + 1] = a[i] / NTT_BASE;
+#else
+		f[i] = a[i];
+#endif
+	}
+}
+
+/*
+ * The convolution modulo one prime as a job.
+ */
+struct ntt_conv_job {
+	const struct ntt_prime *np;
+	unsigned *c;
+	int n;
+	const unsigned *a, *b;
+	int an, bn;
+	unsigned *tmp;
+};
+
+static void ntt_conv_run(void *arg) {
+	struct ntt_conv_job *t = arg;
+	ntt_convolve(t->np, t->c, t->n, t->a, t->an, t->b, t->bn, t->tmp, par_threads);
+}
+
+/*
+ * r[0..an+bn) = a[0..an) * b[0..bn),
+ * NTT_SPLIT * (an + bn) <= NTT_MAX_SIZE.
+ * With several threads the primes are worked on at the same time,
+ * each with scratch space of its own.
+ */
+static void mul_ntt(digit_t *r, const digit_t *a, int an, const digit_t *b, int bn) {
+	int fan = NTT_SPLIT * an, fbn = NTT_SPLIT * bn, fn = fan + fbn;
+	int n = 1;
+	while (n < fn) n <<= 1;
+	int threads = par_budget(an < bn ? an : bn);
+	int scratch = threads > 1 ? NTT_PRIMES : 1; // scratch spaces of 2 * n words
+	unsigned *c = malloc(((NTT_PRIMES + 2 * scratch) * (size_t)n + fn) * sizeof(unsigned));
+	if (!c) exit(EXIT_FAILURE);
+	unsigned *fa = c + (NTT_PRIMES + 2 * scratch) * (size_t)n, *fb = fa + fan;
+	ntt_split(fa, a, an);
+	if (a == b && an == bn) fb = fa; // squaring
+	else ntt_split(fb, b, bn);
+	struct ntt_prime np[NTT_PRIMES];
+	for (int k = 0; k < NTT_PRIMES; ++k) ntt_prime_init(&np[k], NTT_P[k]);
+	if (threads > 1) {
+		struct ntt_conv_job t[NTT_PRIMES];
+		struct par_job jobs[NTT_PRIMES];
+		for (int k = 0; k < NTT_PRIMES; ++k) {
+			struct ntt_conv_job job = {&np[k], c + k * (size_t)n, n, fa, fb, fan, fbn,
+				c + (NTT_PRIMES + 2 * k) * (size_t)n};
+			t[k] = job;
+			jobs[k].run = ntt_conv_run;
+			jobs[k].arg = &t[k];
+		}
+		par_run(jobs, NTT_PRIMES, threads);
+	} else {
+		for (int k = 0; k < NTT_PRIMES; ++k) {
+			ntt_convolve(&np[k], c + k * (size_t)n, n, fa, fan, fb, fbn, c + NTT_PRIMES * (size_t)n, 1);
+		}
+	}
+	// Garner's algorithm: x = v0 + v1 p0 + v2 p0 p1
+	unsigned long long p0 = NTT_P[0], p1 = NTT_P[1], p2 = NTT_P[2];
+	unsigned long long i01 = ntt_pow(&np[1], p0, p1 - 2); // p0^-1 mod p1
+	unsigned long long i012 = ntt_pow(&np[2], p0 * p1 % p2, p2 - 2); // (p0 p1)^-1 mod p2
+	ntt_wide_t carry = 0;
+	for (int i = 0; i < fn; ++i) {
+		unsigned long long v0 = c[i];
+		unsigned long long v1 = (c[n + i] + p1 - v0 % p1) * i01 % p1;
+		unsigned long long s = v0 + v1 * p0; // below p0 p1 < 2^58
+		unsigned long long v2 = (c[2 * n + i] + p2 - s % p2) * i012 % p2;
+		ntt_wide_t x = (ntt_wide_t)v2 * (p0 * p1) + s + carry;
+		carry = x / NTT_BASE;
+		c[i] = x % NTT_BASE; // c[i] is not read again
+	}
+	for (int i = 0; i < an + bn; ++i) {
+#if NTT_SPLIT == 2
+		r[i] = c[2 * i] + (digit_t)c[2 * i + 1] * NTT_BASE;
+#else
+		r[i] = c[i];
+#endif
+	}
+	free(c);
+}
+
+/*
+ * r[0..2n) = a[0..n) * b[0..n).
+ * Dispatch on size for balanced operands.
+ * a == b is squared by every algorithm.
+ */
+static void dig_mul_n(digit_t *r, const digit_t *a, const digit_t *b, int n) {
+	if (n < KARATSUBA_THRESHOLD) {
+		if (a == b) sqr_basecase(r, a, n);
+		else mul_basecase(r, a, n, b, n);
+	} else if (n < TOOM3_THRESHOLD) mul_karatsuba(r, a, b, n);
+	else if (n < NTT_THRESHOLD || NTT_SPLIT * 2 * n > NTT_MAX_SIZE) mul_toom3(r, a, b, n);
+	else mul_ntt(r, a, n, b, n);
+}
+
+/*
+ * r[0..an+bn) = a[0..an) * b[0..bn), an, bn >= 1.
+ * r must not overlap a or b.
+ * Unbalanced operands are multiplied in slices of the shorter size,
+ * unless they are large enough for a single transform.
+ */
+static void dig_mul(digit_t *r, const digit_t *a, int an, const digit_t *b, int bn) {
+	if (an < bn) {
+		const digit_t *t = a;
+		a = b;
+		b = t;
+		int tn = an;
+		an = bn;
+		bn = tn;
+	}
+	if (an == bn) {
+		dig_mul_n(r, a, b, bn);
+		return;
+	}
+	if (bn < KARATSUBA_THRESHOLD) {
+		mul_basecase(r, a, an, b, bn);
+		return;
+	}
+	if (bn >= NTT_THRESHOLD && NTT_SPLIT * (an + bn) <= NTT_MAX_SIZE) {
+		mul_ntt(r, a, an, b, bn);
+		return;
+	}
+	memset(r, 0, (an + bn) * sizeof(digit_t));
+	digit_t *tmp = malloc(2 * bn * sizeof(digit_t));
+	if (!tmp) exit(EXIT_FAILURE);
+	for (int i = 0; i < an; i += bn) {
+		int sn = min(bn, an - i); // slice size
+		dig_mul(tmp, b, bn, a + i, sn);
+		dig_add_into(r + i, an + bn - i, tmp, bn + sn);
+	}
+	free(tmp);
+}
+
+/*
+ * r[0..n) = a[0..n) * d for a single digit d.
+ * Return the carry digit. r may alias a.
+ */
+static digit_t dig_mul_1(digit_t *r, const digit_t *a, int n, digit_t d) {
+	digit_t carry = 0;
+	for (int i = 0; i < n; ++i) {
+		lldigit_t tmp = (lldigit_t)a[i] * d + carry;
+		carry = div_radix(tmp, &r[i]);
+	}
+	return carry;
+}
+
+/*
+ * q[0..n) = u[0..n) / d for a single non-zero digit d.
+ * Return the remainder. q may alias u.
+ */
+static digit_t dig_divmod_1(digit_t *q, const digit_t *u, int n, digit_t d) {
+	lldigit_t rem = 0;
+	for (int i = n - 1; i >= 0; --i) {
+		rem = rem * RADIX + u[i];
+		q[i] = rem / d;
+		rem %= d;
+	}
+	return rem;
+}
+
+/*
+ * dst = a * b (signed), exactly, reusing the digits of dst.
+ * dst may alias a or b.
+ * Leading zeroes are skipped before choosing the algorithm, and an
+ * operand of a single digit scales the other in place.
+ */
+static void mul_into(struct bignum *dst, const struct bignum *a, const struct bignum *b) {
+	int an = dig_len(a->digits, a->num_digits);
+	int bn = dig_len(b->digits, b->num_digits);
+	if (an == 1 || bn == 1) {
+		STAT_BEGIN(BIGNUM_STAT_MUL, a->num_digits + b->num_digits);
+		const struct bignum *x = bn == 1 ? a : b; // the scaled operand
+		int xn = bn == 1 ? an : bn;
+		digit_t d = (bn == 1 ? b : a)->digits[0];
+		int sign = a->sign ^ b->sign;
+		int point_offset = a->point_offset + b->point_offset;
+		int n = max(xn + 1, point_offset);
+		bignum_resize(dst, n);
+		if (dst != x) memcpy(dst->digits, x->digits, xn * sizeof(digit_t));
+		memset(dst->digits + xn + 1, 0, (n - xn - 1) * sizeof(digit_t));
+		dst->digits[xn] = dig_mul_1(dst->digits, dst->digits, xn, d);
+		dst->sign = sign;
+		dst->point_offset = point_offset;
+		STAT_END();
+		return;
+	}
+	if (dst == a || dst == b) {
+		// the product cannot be formed over its operands
+		struct bignum tmp;
+		bignum_init(&tmp, dst->arena);
+		mul_into(&tmp, a, b);
+		bignum_take(dst, &tmp);
+		return;
+	}
+	STAT_BEGIN(BIGNUM_STAT_MUL, a->num_digits + b->num_digits);
+	bignum_resize(dst, a->num_digits + b->num_digits);
+	dst->sign = a->sign ^ b->sign;
+	dst->point_offset = a->point_offset + b->point_offset;
+	int rn = an && bn ? an + bn : 0; // digits written by dig_mul
+	if (rn) dig_mul(dst->digits, a->digits, an, b->digits, bn);
+	memset(dst->digits + rn, 0, (dst->num_digits - rn) * sizeof(digit_t));
+	STAT_END();
+}
+
+/*
+ * dst = a * b (signed), reusing the digits of dst.
+ * dst may alias a or b.
+ */
+void bignum_mul_into(struct bignum *dst, const struct bignum *a, const struct bignum *b) {
+	mul_into(dst, a, b);
+	normalize_prec(dst);
+}
+
+/*
+ * dst = a * a, reusing the digits of dst.
+ * dst may alias a.
+ * The operand is passed twice down to the kernels, which square it.
+ */
+void bignum_sqr_into(struct bignum *dst, const struct bignum *a) {
+	bignum_mul_into(dst, a, a);
+}
+
+/*
+ * Return a * b (signed).
+ */
+struct bignum *long_mul(const struct bignum *a, const struct bignum *b) {
+	struct bignum *ret = bignum_new();
+	bignum_mul_into(ret, a, b);
+	return ret;
+}
+
+/*
+ * q[0..un-vn+1) = u[0..un) / v[0..vn), r[0..vn) = u mod v.
+ * Requires un >= vn and v[vn - 1] != 0. r may be NULL.
+ * Knuth's Algorithm D (TAOCP 4.3.1): the divisor is normalized so that
+ * its top digit is at least RADIX/2, then each quotient digit is estimated
+ * from the top two digits of the remainder and corrected at most twice.
+ */
+static void div_newton(digit_t *q, digit_t *r, const digit_t *u, int un, const digit_t *v, int vn);
+
+// divisor and quotient size (in bignum digits) above which div_newton is used
+#define DIV_NEWTON_THRESHOLD 100
+
+static void dig_divmod(digit_t *q, digit_t *r, const digit_t *u, int un, const digit_t *v, int vn) {
+	if (vn >= DIV_NEWTON_THRESHOLD && un - vn + 1 >= DIV_NEWTON_THRESHOLD) {
+		div_newton(q, r, u, un, v, vn);
+		return;
+	}
+	if (vn == 1) {
+		digit_t rem = dig_divmod_1(q, u, un, v[0]);
+		if (r) r[0] = rem;
+		return;
+	}
+	digit_t *un_ = malloc((un + 1 + vn) * sizeof(digit_t));
+	if (!un_) exit(EXIT_FAILURE);
+	digit_t *vn_ = un_ + un + 1;
+	// normalize
+	digit_t d = RADIX / ((lldigit_t)v[vn - 1] + 1);
+	un_[un] = dig_mul_1(un_, u, un, d);
+	dig_mul_1(vn_, v, vn, d);
+	digit_t vtop = vn_[vn - 1], vnext = vn_[vn - 2];
+
+	for (int j = un - vn; j >= 0; --j) {
+		digit_t *uj = un_ + j;
+		// estimate quotient digit from the top two digits
+		lldigit_t num = (lldigit_t)uj[vn] * RADIX + uj[vn - 1];
+		lldigit_t qhat = num / vtop;
+		lldigit_t rhat = num % vtop;
+		while (qhat >= RADIX || qhat * vnext > rhat * RADIX + uj[vn - 2]) {
+			--qhat;
+			rhat += vtop;
+			if (rhat >= RADIX) break;
+		}
+		// multiply and subtract
+		digit_t carry = 0;
+		digit_t borrow = 0;
+		for (int i = 0; i < vn; ++i) {
+			digit_t sub;
+			carry = div_radix(qhat * vn_[i] + carry, &sub);
+			sub += borrow;
+			borrow = uj[i] < sub;
+			uj[i] = borrow ? uj[i] + RADIX - sub : uj[i] - sub;
+		}
+		digit_t sub = carry + borrow;
+		if (uj[vn] < sub) {
+			// qhat was one too large, add back
+			--qhat;
+			uj[vn] += RADIX - sub;
+			if (dig_add(uj, uj, vn, vn_, vn)) uj[vn] = 0;
+		} else {
+			uj[vn] -= sub;
+		}
+		q[j] = qhat;
+	}
+	// unnormalize the remainder
+	if (r) dig_divmod_1(r, un_, vn, d);
+	free(un_);
+}
+
+/*
+ * Reciprocals below this size (in bignum digits) are computed by
+ * Algorithm D directly. Must be at least 4 so that recursion shrinks.
+ */
+#define RECIP_BASE 16
+
+/*
+ * x[0..n+2) = R^2n / v[0..n) approximately, within a few units,
+ * where R = RADIX and v[n - 1] != 0.
+ * Newton iteration x' = x + x (1 - v x / R^2n), where the starting x is
+ * the reciprocal of the top h digits of v, computed recursively.
+ * Each step doubles the number of correct digits.
+ */
+static void recip_approx(digit_t *x, const digit_t *v, int n) {
+	if (n <= RECIP_BASE) {
+		digit_t *u = calloc(2 * n + 1, sizeof(digit_t));
+		if (!u) exit(EXIT_FAILURE);
+		u[2 * n] = 1;
+		dig_divmod(x, NULL, u, 2 * n + 1, v, n);
+		free(u);
+		return;
+	}
+	int h = n / 2 + 2; // enough guard digits to keep the error within a few units
+	int pn = n + h + 2;
+	digit_t *xh = malloc((h + 2 + 3 * pn + h + 2) * sizeof(digit_t));
+	if (!xh) exit(EXIT_FAILURE);
+	digit_t *p = xh + h + 2, *e = p + pn, *d = e + pn;
+	recip_approx(xh, v + n - h, h); // ~ R^2h / vh
+	int xhn = dig_len(xh, h + 2);
+	// p = v * xh ~ R^(n + h), e = |R^(n + h) - p|
+	dig_mul(p, v, n, xh, xhn);
+	memset(p + n + xhn, 0, (h + 2 - xhn) * sizeof(digit_t));
+	int neg = p[n + h + 1] || p[n + h]; // is x an overestimate
+	memset(e, 0, pn * sizeof(digit_t));
+	if (neg) {
+		digit_t one = 1;
+		memcpy(e, p, pn * sizeof(digit_t));
+		dig_sub_into(e + n + h, 2, &one, 1);
+	} else {
+		e[n + h] = 1;
+		dig_sub_into(e, n + h + 1, p, n + h);
+	}
+	// x = xh R^(n - h) +- xh e / R^2h
+	memset(x, 0, (n - h) * sizeof(digit_t));
+	memcpy(x + n - h, xh, (h + 2) * sizeof(digit_t));
+	int en = dig_len(e, pn);
+	if (en && en + xhn > 2 * h) {
+		dig_mul(d, e, en, xh, xhn);
+		if (neg) dig_sub_into(x, n + 2, d + 2 * h, en + xhn - 2 * h);
+		else dig_add_into(x, n + 2, d + 2 * h, en + xhn - 2 * h);
+	}
+	free(xh);
+}
+
+/*
+ * x[0..n+2) = floor(R^2n / v[0..n)), where v[n - 1] != 0.
+ */
+static void dig_recip(digit_t *x, const digit_t *v, int n) {
+	recip_approx(x, v, n);
+	// fix the last few units: v x <= R^2n < v (x + 1)
+	digit_t *t = calloc(2 * (2 * n + 3), sizeof(digit_t));
+	if (!t) exit(EXIT_FAILURE);
+	digit_t *s = t + 2 * n + 3;
+	digit_t one = 1;
+	int xn = dig_len(x, n + 2);
+	if (xn) dig_mul(t, x, xn, v, n);
+	// t > R^2n
+	while (dig_len(t, 2 * n + 3) > 2 * n + 1 || t[2 * n] > 1 || (t[2 * n] == 1 && dig_len(t, 2 * n))) {
+		dig_sub_into(x, n + 2, &one, 1);
+		dig_sub_into(t, 2 * n + 3, v, n);
+	}
+	for (;;) {
+		// s = t + v <= R^2n
+		memcpy(s, t, (2 * n + 3) * sizeof(digit_t));
+		dig_add_into(s, 2 * n + 3, v, n);
+		if (s[2 * n + 1] || s[2 * n] > 1 || (s[2 * n] == 1 && dig_len(s, 2 * n))) break;
+		dig_add_into(x, n + 2, &one, 1);
+		memcpy(t, s, (2 * n + 3) * sizeof(digit_t));
+	}
+	free(t);
+}
+
+/*
+ * Same contract as dig_divmod, for large divisors.
+ * The dividend is split into blocks of vn digits which are divided from
+ * the top with Barrett's method (HAC 14.42) using the reciprocal of v.
+ * Each block costs two multiplications and at most two corrections.
+ */
+static void div_newton(digit_t *q, digit_t *r, const digit_t *u, int un, const digit_t *v, int vn) {
+	int n = vn;
+	int nb = (un + n - 1) / n; // number of blocks
+	digit_t *x = calloc(n + 2 + 2 * n + (2 * n + 3) + 2 * n + nb * n, sizeof(digit_t));
+	if (!x) exit(EXIT_FAILURE);
+	digit_t *num = x + n + 2; // rem R^n + block
+	digit_t *qx = num + 2 * n; // q1 * x
+	digit_t *t = qx + 2 * n + 3; // q3 * v
+	digit_t *qb = t + 2 * n; // quotient blocks
+	dig_recip(x, v, n);
+	int xn = dig_len(x, n + 2);
+	// the top block is the first remainder if it is less than v
+	int j = nb - 1;
+	int top = un - j * n; // size of the top block
+	memcpy(num + n, u + j * n, top * sizeof(digit_t));
+	if (top < n || dig_cmp(num + n, v, n) < 0) --j;
+	else memset(num + n, 0, n * sizeof(digit_t));
+	for (; j >= 0; --j) {
+		memcpy(num, u + j * n, n * sizeof(digit_t));
+		// q3 = floor(floor(num / R^(n - 1)) * x / R^(n + 1))
+		int q1n = dig_len(num + n - 1, n + 1);
+		memset(qx, 0, (2 * n + 3) * sizeof(digit_t));
+		if (q1n) dig_mul(qx, num + n - 1, q1n, x, xn);
+		digit_t *q3 = qx + n + 1; // at most n digits since q3 <= num / v < R^n
+		int q3n = dig_len(q3, n);
+		// num -= q3 v, then at most two corrections
+		if (q3n) {
+			dig_mul(t, q3, q3n, v, n);
+			dig_sub_into(num, 2 * n, t, q3n + n);
+		}
+		while (dig_len(num + n, n) || dig_cmp(num, v, n) >= 0) {
+			dig_sub_into(num, 2 * n, v, n);
+			digit_t one = 1;
+			dig_add_into(q3, n, &one, 1);
+		}
+		memcpy(qb + j * n, q3, n * sizeof(digit_t));
+		// the remainder moves up to become the top half of the next num
+		memcpy(num + n, num, n * sizeof(digit_t));
+	}
+	memcpy(q, qb, (un - n + 1) * sizeof(digit_t));
+	if (r) memcpy(r, num + n, n * sizeof(digit_t));
+	free(x);
+}
+
+/*
+ * dst = signed a/b to `prec' bignum digits of precision after point,
+ * reusing the digits of dst. dst may alias a or b.
+ * The quotient is truncated, i.e. it is (a * RADIX^naz) / b in integers
+ * for the naz that gives `prec' digits after point.
+ * Return 0, or -1 when b = 0 in which case dst is left unchanged.
+ */
+static int div_into(struct bignum *dst, const struct bignum *a, const struct bignum *b, int prec) {
+	// number of digits in b ignoring leading zeroes
+	int bn = dig_len(b->digits, b->num_digits);
+	if (!bn) {
+		// division by zero
+		return -1;
+	}
+	if (dst == b) {
+		// the divisor is read while the quotient is formed
+		struct bignum tmp;
+		bignum_init(&tmp, dst->arena);
+		div_into(&tmp, a, b, prec);
+		bignum_take(dst, &tmp);
+		return 0;
+	}
+	STAT_BEGIN(BIGNUM_STAT_DIV, a->num_digits + b->num_digits);
+	int an = dig_len(a->digits, a->num_digits);
+	// number of zeroes appended to a for precision, may be -ve
+	int naz = prec + b->point_offset - a->point_offset;
+	int un = an + naz; // number of digits in the shifted dividend
+	if (bn == 1 && un > 0) {
+		// a single digit divisor divides the shifted dividend in place
+		digit_t d = b->digits[0];
+		int sign = a->sign ^ b->sign;
+		int at = max(naz, 0), len = naz < 0 ? un : an;
+		const digit_t *src = a->digits + (naz < 0 ? -naz : 0);
+		bignum_resize(dst, max(un, prec + 1));
+		if (dst == a) src = dst->digits + (naz < 0 ? -naz : 0);
+		memmove(dst->digits + at, src, len * sizeof(digit_t));
+		memset(dst->digits, 0, at * sizeof(digit_t));
+		memset(dst->digits + at + len, 0, (dst->num_digits - at - len) * sizeof(digit_t));
+		dig_divmod_1(dst->digits, dst->digits, un, d);
+		dst->sign = sign;
+		dst->point_offset = prec;
+		STAT_END();
+		return 0;
+	}
+	// copy the dividend before dst, possibly a, is overwritten
+	digit_t *u = NULL;
+	if (un >= bn) {
+		u = calloc(un, sizeof(digit_t));
+		if (!u) exit(EXIT_FAILURE);
+		if (naz >= 0) memcpy(u + naz, a->digits, an * sizeof(digit_t));
+		else memcpy(u, a->digits - naz, un * sizeof(digit_t));
+	}
+	dst->sign = a->sign ^ b->sign;
+	bignum_resize(dst, max(un - bn + 1, prec + 1));
+	memset(dst->digits, 0, dst->num_digits * sizeof(digit_t));
+	dst->point_offset = prec;
+	if (u) {
+		dig_divmod(dst->digits, NULL, u, un, b->digits, bn);
+		free(u);
+	} // else the quotient is zero
+	STAT_END();
+	return 0;
+}
+
+/*
+ * dst = signed a/b to the precision of this thread (truncated),
+ * reusing the digits of dst. dst may alias a or b.
+ * Return 0, or -1 when b = 0 in which case dst is left unchanged.
+ */
+int bignum_div_into(struct bignum *dst, const struct bignum *a, const struct bignum *b) {
+	if (div_into(dst, a, b, precision_digits())) return -1;
+	normalize(dst);
+	return 0;
+}
+
+/*
+ * Return signed a/b to the precision of this thread (truncated).
+ * Return NULL when b = 0.
+ */
+struct bignum *long_div(const struct bignum *a, const struct bignum *b) {
+	struct bignum *ret = bignum_new();
+	if (bignum_div_into(ret, a, b)) {
+		bignum_free(ret);
+		return NULL;
+	}
+	return ret;
+}
+
+/*
+ * Machine word operands.
+ * The word is put in a bignum on the stack, which takes no allocation
+ * while it fits in the inline digits, and the results are computed in
+ * place in dst. A word below RADIX is a single digit, so multiplication
+ * and division by it take one pass over the digits of a, without
+ * temporary digit arrays.
+ */
+
+/*
+ * Initialize t on the stack as x. Free it with digits_free.
+ */
+static void word_init(struct bignum *t, unsigned long x) {
+	bignum_init(t, 0);
+	int_set(t, x);
+}
+
+/*
+ * dst = a + x, reusing the digits of dst.
+ * dst may alias a.
+ */
+void bignum_add_ui(struct bignum *dst, const struct bignum *a, unsigned long x) {
+	struct bignum t;
+	word_init(&t, x);
+	addsub_into(dst, a, &t, 0);
+	digits_free(&t);
+	normalize_prec(dst);
+}
+
+/*
+ * dst = a * x, reusing the digits of dst.
+ * dst may alias a.
+ */
+void bignum_mul_ui(struct bignum *dst, const struct bignum *a, unsigned long x) {
+	struct bignum t;
+	word_init(&t, x);
+	mul_into(dst, a, &t);
+	digits_free(&t);
+	normalize_prec(dst);
+}
+
+/*
+ * dst = a / x to the precision of this thread (truncated), reusing the
+ * digits of dst. dst may alias a.
+ * Return -1 when x = 0, leaving dst unchanged, else 0.
+ */
+int bignum_div_ui(struct bignum *dst, const struct bignum *a, unsigned long x) {
+	if (!x) return -1;
+	struct bignum t;
+	word_init(&t, x);
+	div_into(dst, a, &t, precision_digits());
+	digits_free(&t);
+	normalize(dst);
+	return 0;
+}
+
+/*
+ * Return -ve if a < x, 0 if a == x, +ve if a > x (signed).
+ */
+int bignum_cmp_ui(const struct bignum *a, unsigned long x) {
+	if (a->sign && dig_len(a->digits, a->num_digits)) return -1;
+	struct bignum t;
+	word_init(&t, x);
+	int cmp = mag_comp(a, &t);
+	digits_free(&t);
+	return cmp;
+}
+
+// TODO: error checking
+
+/*
+ * Trims the bignum to `prec' bignum digits of precision.
+ */
+static struct bignum *trim_fraction(const struct bignum *num, int prec) {
+	struct bignum *ret = bignum_alloc(num->num_digits - num->point_offset + prec);
+	ret->sign = num->sign;
+	ret->point_offset = prec;
+	for (int i = 0; i < ret->num_digits; ++i) {
+		ret->digits[i] = num->digits[i + num->point_offset - prec];
+	}
+	return ret;
+}
+
+/*
+ * Compare a[0..an) with b[0..bn), leading zeroes allowed.
+ */
+static int dig_comp(const digit_t *a, int an, const digit_t *b, int bn) {
+	an = dig_len(a, an);
+	bn = dig_len(b, bn);
+	if (an != bn) return an < bn ? -1 : 1;
+	return dig_cmp(a, b, an);
+}
+
+/*
+ * s[0..(wn+1)/2) = floor(sqrt(w[0..wn))).
+ * Heron's iteration x' = (x + w/x)/2, which decreases monotonically to the
+ * answer when started from above. The start comes from the top digits.
+ */
+static void sqrt_heron(digit_t *s, const digit_t *w, int wn) {
+	int sn = (wn + 1) / 2;
+	memset(s, 0, sn * sizeof(digit_t));
+	wn = dig_len(w, wn);
+	if (!wn) return;
+	int xn = (wn + 1) / 2 + 1;
+	digit_t *x = calloc(2 * xn + wn + 1, sizeof(digit_t));
+	if (!x) exit(EXIT_FAILURE);
+	digit_t *y = x + xn, *q = y + xn;
+	// x = (isqrt(t) + 1) R^k >= sqrt(w), t being the top one or two digits
+	int k = (wn - 1) / 2;
+	lldigit_t t = w[2 * k];
+	if (2 * k + 1 < wn) t += (lldigit_t)w[2 * k + 1] * RADIX;
+	lldigit_t r = t, rn = (t + 1) / 2;
+	while (rn < r) {
+		r = rn;
+		rn = (r + t / r) / 2;
+	}
+	x[k] = r + 1;
+	if (x[k] == RADIX) {
+		x[k] = 0;
+		x[k + 1] = 1;
+	}
+	for (;;) {
+		int cn = dig_len(x, xn);
+		memset(q, 0, (wn + 1) * sizeof(digit_t));
+		if (wn >= cn) dig_divmod(q, NULL, w, wn, x, cn);
+		// y = (x + q) / 2
+		memcpy(y, x, xn * sizeof(digit_t));
+		dig_add_into(y, xn, q, wn - cn + 1);
+		dig_divmod_1(y, y, xn, 2);
+		if (dig_cmp(y, x, xn) >= 0) break;
+		memcpy(x, y, xn * sizeof(digit_t));
+	}
+	memcpy(s, x, sn * sizeof(digit_t));
+	free(x);
+}
+
+/*
+ * Inverse square roots below this size (half the digits of the operand)
+ * are computed directly. Must be at least 4 so that recursion shrinks.
+ */
+#define SQRT_BASE 16
+
+/*
+ * y[0..m+2) = R^2m / sqrt(n[0..2m)) approximately, within a few units,
+ * where R = RADIX and n[2m - 1] or n[2m - 2] is non-zero.
+ * Newton iteration y' = y + y (1 - n y^2 / R^4m) / 2, where the starting y
+ * comes recursively from the top 2h digits of n. Only multiplications are
+ * involved, and each step doubles the number of correct digits.
+ */
+static void invsqrt_approx(digit_t *y, const digit_t *n, int m) {
+	if (m <= SQRT_BASE) {
+		// y = isqrt(R^4m / n)
+		digit_t *u = calloc(4 * m + 1 + 2 * m + 3, sizeof(digit_t));
+		if (!u) exit(EXIT_FAILURE);
+		digit_t *w = u + 4 * m + 1;
+		u[4 * m] = 1;
+		int nn = dig_len(n, 2 * m);
+		dig_divmod(w, NULL, u, 4 * m + 1, n, nn);
+		memset(y, 0, (m + 2) * sizeof(digit_t));
+		sqrt_heron(y, w, 4 * m + 2 - nn);
+		free(u);
+		return;
+	}
+	int h = m / 2 + 2; // enough guard digits to keep the error within a few units
+	int pn = 2 * m + 2 * h + 4;
+	digit_t *yh = calloc(h + 2 + 2 * h + 4 + 2 * pn + h + 2 + pn, sizeof(digit_t));
+	if (!yh) exit(EXIT_FAILURE);
+	digit_t *y2 = yh + h + 2, *p = y2 + 2 * h + 4, *e = p + pn, *d = e + pn;
+	invsqrt_approx(yh, n + 2 * (m - h), h); // ~ R^2h / sqrt(nh)
+	int yhn = dig_len(yh, h + 2);
+	// p = n yh^2 ~ R^(2m + 2h), e = |R^(2m + 2h) - p|
+	dig_mul(y2, yh, yhn, yh, yhn);
+	int y2n = dig_len(y2, 2 * yhn);
+	dig_mul(p, n, 2 * m, y2, y2n);
+	int top = 2 * m + 2 * h; // position of the unit R^(2m + 2h)
+	int neg = dig_len(p + top, pn - top) != 0; // is y an overestimate
+	if (neg) {
+		digit_t one = 1;
+		memcpy(e, p, pn * sizeof(digit_t));
+		dig_sub_into(e + top, pn - top, &one, 1);
+	} else {
+		e[top] = 1;
+		dig_sub_into(e, top + 1, p, top);
+	}
+	// y = yh R^(m - h) +- yh e / (2 R^(m + 3h))
+	memset(y, 0, (m + 2) * sizeof(digit_t));
+	memcpy(y + m - h, yh, (h + 2) * sizeof(digit_t));
+	int en = dig_len(e, pn);
+	int shift = m + 3 * h;
+	if (en && en + yhn > shift) {
+		dig_mul(d, e, en, yh, yhn);
+		dig_divmod_1(d + shift, d + shift, en + yhn - shift, 2);
+		if (neg) dig_sub_into(y, m + 2, d + shift, en + yhn - shift);
+		else dig_add_into(y, m + 2, d + shift, en + yhn - shift);
+	}
+	free(yh);
+}
+
+/*
+ * s[0..(un+1)/2) = floor(sqrt(u[0..un))).
+ * Small numbers use Heron's iteration. Larger ones multiply u by its
+ * approximate inverse square root and fix the last few units.
+ */
+static void dig_sqrt(digit_t *s, const digit_t *u, int un) {
+	un = dig_len(u, un);
+	if (un <= 2 * SQRT_BASE) {
+		sqrt_heron(s, u, un);
+		return;
+	}
+	int m = (un + 1) / 2;
+	digit_t *n = calloc(2 * m + (m + 2) + (3 * m + 2) + 2 * (2 * m + 4), sizeof(digit_t));
+	if (!n) exit(EXIT_FAILURE);
+	digit_t *y = n + 2 * m, *t = y + m + 2, *sq = t + 3 * m + 2, *odd = sq + 2 * m + 4;
+	memcpy(n, u, un * sizeof(digit_t));
+	invsqrt_approx(y, n, m);
+	// x = n y / R^2m ~ sqrt(n)
+	dig_mul(t, n, 2 * m, y, dig_len(y, m + 2));
+	digit_t *x = t + 2 * m;
+	int xn = m + 2;
+	// fix the last units: x^2 <= n < (x + 1)^2
+	memset(sq, 0, (2 * m + 4) * sizeof(digit_t));
+	int cn = dig_len(x, xn);
+	if (cn) dig_mul(sq, x, cn, x, cn);
+	digit_t one = 1;
+	while (dig_comp(sq, 2 * xn, n, 2 * m) > 0) {
+		// (x - 1)^2 = x^2 - (2x - 1)
+		memset(odd, 0, (xn + 1) * sizeof(digit_t));
+		odd[xn] = dig_add(odd, x, xn, x, xn);
+		dig_sub_into(odd, xn + 1, &one, 1);
+		dig_sub_into(sq, 2 * xn, odd, xn + 1);
+		dig_sub_into(x, xn, &one, 1);
+	}
+	for (;;) {
+		// (x + 1)^2 = x^2 + (2x + 1)
+		memset(odd, 0, 2 * xn * sizeof(digit_t));
+		odd[xn] = dig_add(odd, x, xn, x, xn);
+		dig_add_into(odd, xn + 1, &one, 1);
+		dig_add_into(odd, 2 * xn, sq, 2 * xn);
+		if (dig_comp(odd, 2 * xn, n, 2 * m) > 0) break;
+		memcpy(sq, odd, 2 * xn * sizeof(digit_t));
+		dig_add_into(x, xn, &one, 1);
+	}
+	memcpy(s, x, m * sizeof(digit_t));
+	free(n);
+}
+
+/*
+ * Return sqrt a to `prec' bignum digits of precision.
+ * The root is truncated, i.e. it is the integer square root of
+ * a * RADIX^naz for the naz that gives `prec' digits after point.
+ * Ignore sign.
+ */
+static struct bignum *sqrt_unsigned(const struct bignum *a, int prec) {
+	STAT_BEGIN(BIGNUM_STAT_SQRT, a->num_digits);
+	int an = dig_len(a->digits, a->num_digits);
+	// number of zeroes appended to a for precision, may be -ve
+	int naz = prec * 2 - a->point_offset;
+	int un = an + naz; // number of digits in the shifted radicand
+	struct bignum *ret = bignum_alloc(max((un + 1) / 2, prec + 1));
+	ret->point_offset = prec;
+	if (un > 0) {
+		digit_t *u = calloc(un, sizeof(digit_t));
+		if (!u) exit(EXIT_FAILURE);
+		if (naz >= 0) memcpy(u + naz, a->digits, an * sizeof(digit_t));
+		else memcpy(u, a->digits - naz, un * sizeof(digit_t));
+		dig_sqrt(ret->digits, u, un);
+		free(u);
+	}
+	STAT_END();
+	return ret;
+}
+
+/*
+ * Return sqrt(a) to the precision of this thread if a is non-negative.
+ * Else return NULL.
+ */
+struct bignum *sqrt_signed(const struct bignum *a) {
+	if (a->sign && dig_len(a->digits, a->num_digits)) {
+		return NULL;
+	}
+	struct bignum *ret = sqrt_unsigned(a, precision_digits());
+	normalize(ret);
+	return ret;
+}
+
+/*
+ * Make room for `num_digits' digits in num without changing it.
+ */
+static void bignum_reserve(struct bignum *num, int num_digits) {
+	int n = num->num_digits;
+	bignum_resize(num, num_digits);
+	num->num_digits = n;
+}
+
+/*
+ * Return log2(x) for x >= 1, to about 20 bits after point.
+ */
+static double log2_approx(double x) {
+	double l = 0;
+	while (x >= 2) {
+		x /= 2;
+		++l;
+	}
+	double bit = 0.5;
+	for (int i = 0; i < 20; ++i) {
+		x *= x;
+		if (x >= 2) {
+			x /= 2;
+			l += bit;
+		}
+		bit /= 2;
+	}
+	return l;
+}
+
+/*
+ * Upper bound on the digits of a ^ e, or -1 if it does not fit an int.
+ */
+static int pow_size(const struct bignum *a, double e) {
+	int an = dig_len(a->digits, a->num_digits);
+	if (an <= 1 && (!an || a->digits[0] <= 1)) return a->num_digits;
+	// a < lead * RADIX^(an - 1)
+	double lead = a->digits[an - 1] + (an > 1 ? (a->digits[an - 2] + 1.0) / RADIX : 1.0);
+	double digits = e * (an - 1 + log2_approx(lead) / log2_approx(RADIX)) + 2;
+	return digits < (1 << 30) ? (int)digits : -1;
+}
+
+/*
+ * Bound on log a ^ e to base RADIX for a != 0, from above if `upper',
+ * else from below: the position of the leading digit of a ^ e relative
+ * to the point, in bignum digits.
+ */
+static double pow_log(const struct bignum *a, double e, int upper) {
+	int an = dig_len(a->digits, a->num_digits);
+	// lead * RADIX^(an - 1) bounds a without its point
+	double lead = a->digits[an - 1] + (an > 1 ? (a->digits[an - 2] + upper) / (double)RADIX : upper);
+	return e * (an - 1 - a->point_offset + log2_approx(lead) / log2_approx(RADIX));
+}
+
+/*
+ * Return d[0..n) as a double.
+ */
+static double dig_value(const digit_t *d, int n) {
+	double v = 0;
+	for (int i = n - 1; i >= 0; --i) v = v * RADIX + d[i];
+	return v;
+}
+
+/*
+ * Truncate num to `w' digits after point if w >= 0, and drop its
+ * leading zeroes.
+ */
+static void pow_trim(struct bignum *num, int w) {
+	if (w >= 0) trim_into(num, w);
+	trim_leading(num);
+}
+
+// window size in bits for exponents of up to POW_WINDOW_BITS[k] bits
+static const int POW_WINDOW_BITS[] = {0, 7, 23, 79, 239};
+#define POW_MAX_WINDOW 5
+
+/*
+ * Return the window size for an exponent of `nbits' bits.
+ */
+static int pow_window(int nbits) {
+	int k = 1;
+	while (k < POW_MAX_WINDOW && nbits > POW_WINDOW_BITS[k]) ++k;
+	return k;
+}
+
+/*
+ * Return the bits of e[0..en), en >= 1 and e[en - 1] != 0, least
+ * significant first in a malloc'd array, and their number in nbits.
+ * A few bits are taken per division by a power of 2.
+ */
+static char *exp_bits(const digit_t *e, int en, int *nbits) {
+	digit_t chunk = 2; // largest power of 2 below RADIX
+	int chunk_bits = 1;
+	while (chunk * 2 < RADIX) chunk *= 2, ++chunk_bits;
+	digit_t *q = malloc(en * sizeof(digit_t));
+	char *bits = malloc((size_t)en * RNUM * 4 + chunk_bits);
+	if (!q || !bits) exit(EXIT_FAILURE);
+	memcpy(q, e, en * sizeof(digit_t));
+	*nbits = 0;
+	for (int qn = en; qn; qn = dig_len(q, qn)) {
+		digit_t rem = dig_divmod_1(q, q, qn, chunk);
+		for (int i = 0; i < chunk_bits; ++i, rem >>= 1) bits[(*nbits)++] = rem & 1;
+	}
+	while (!bits[*nbits - 1]) --*nbits;
+	free(q);
+	return bits;
+}
+
+/*
+ * Raise to arbitrary integer exponents (i.e. ignoring point_offset).
+ * Return a ^ b, exactly if `prec' < 0, else to `prec' bignum digits
+ * after point (truncated, with an error below a unit of the last).
+ * Sign of b is ignored.
+ * Left to right sliding window exponentiation over the bits of b:
+ * every bit costs a squaring, and every window of up to k bits starting
+ * and ending with a one costs a multiplication by a precomputed odd
+ * power of a, so about log2(b) (1 + 1 / (k + 1)) multiplications are made.
+ * A fractional a is raised keeping `w' digits after point in every
+ * product: prec, the digits before point of the result, as the unit of
+ * the last digit kept grows with the magnitude, and those of b times the
+ * number of products, as each truncation of a ^ i is raised to b / i
+ * later on.
+ */
+static struct bignum *pow_uint(const struct bignum *a, const struct bignum *b, int prec) {
+	struct bignum *ret = bignum_alloc(1);
+	ret->digits[0] = 1;
+	int bn = dig_len(b->digits, b->num_digits);
+	if (!bn) return ret;
+
+	int nbits;
+	char *bits = exp_bits(b->digits, bn, &nbits);
+	double e = dig_value(b->digits, bn); // b as a double, for the size estimates
+	int k = pow_window(nbits);
+	// odd powers a, a^3, ..., a^(2^k - 1)
+	int npow = 1 << (k - 1);
+	int w = -1; // digits kept after point, all if -ve
+	double whole = 0; // digits of the result before point
+	if (prec >= 0 && dig_len(a->digits, a->point_offset)) {
+		whole = pow_log(a, e, 1) + 1;
+		if (whole < 0) whole = 0;
+		double guard = log2_approx(e * (2 * nbits + npow)) / log2_approx(RADIX) + 1;
+		double dw = prec + whole + guard;
+		// unless the exact result has no more digits after point
+		if (dw < e * a->point_offset && dw < (1 << 29)) w = (int)dw;
+	}
+	struct bignum *pw[1 << (POW_MAX_WINDOW - 1)];
+	pw[0] = clone(a);
+	pow_trim(pw[0], w);
+	if (npow > 1) {
+		struct bignum *a2 = bignum_new();
+		mul_into(a2, pw[0], pw[0]);
+		pow_trim(a2, w);
+		for (int i = 1; i < npow; ++i) {
+			pw[i] = bignum_new();
+			mul_into(pw[i], pw[i - 1], a2);
+			pow_trim(pw[i], w);
+		}
+		bignum_free(a2);
+	}
+
+	// the result and the step being formed swap in turn, with room for
+	// the whole result reserved upfront where it can be told
+	struct bignum *prod = bignum_new(), *swp;
+	int size = pow_size(pw[0], e);
+	if (w >= 0 && (size < 0 || size > 2 * (whole + w + 1))) {
+		// a product before it is truncated
+		size = 2 * ((int)whole + w + 1);
+	}
+	if (size > 0) {
+		bignum_reserve(ret, size);
+		bignum_reserve(prod, size);
+	}
+	int first = 1;
+	for (int i = nbits - 1; i >= 0;) {
+		if (!bits[i]) {
+			mul_into(prod, ret, ret);
+			pow_trim(prod, w);
+			swp = ret, ret = prod, prod = swp;
+			--i;
+			continue;
+		}
+		// the longest window bits[j..i] of at most k bits with bits[j] set
+		int j = i - k + 1 > 0 ? i - k + 1 : 0;
+		while (!bits[j]) ++j;
+		int win = 0;
+		for (int t = i; t >= j; --t) win = 2 * win + bits[t];
+		if (first) {
+			bignum_copy_into(ret, pw[win / 2]);
+			first = 0;
+		} else {
+			for (int t = i; t >= j; --t) {
+				mul_into(prod, ret, ret);
+				pow_trim(prod, w);
+				swp = ret, ret = prod, prod = swp;
+			}
+			mul_into(prod, ret, pw[win / 2]);
+			pow_trim(prod, w);
+			swp = ret, ret = prod, prod = swp;
+		}
+		i = j - 1;
+	}
+	bignum_free(prod);
+	for (int i = 0; i < npow; ++i) bignum_free(pw[i]);
+	free(bits);
+	return ret;
+}
+
+/*
+ * Raise power to signed ints.
+ * Return a ^ b, to `prec' bignum digits of precision.
+ * Sign of a is ignored.
+ * Return NULL if a = 0 and b < 0.
+ */
+static struct bignum *pow_sint(const struct bignum *a, const struct bignum *b, int prec) {
+	int work = prec;
+	if (b->sign && dig_len(a->digits, a->num_digits)) {
+		// 1 / x has an error of that of x over x^2, so x needs twice
+		// the zero digits it has after point more
+		double z = -pow_log(a, dig_value(b->digits, dig_len(b->digits, b->num_digits)), 0);
+		if (z > 0) work = z < (1 << 28) ? prec + 2 * ((int)z + 1) : -1;
+	}
+	struct bignum *ret = pow_uint(a, b, work);
+	if (b->sign) {
+		struct bignum one;
+		bignum_init(&one, 0);
+		bignum_resize(&one, 1);
+		one.digits[0] = 1;
+		if (div_into(ret, &one, ret, prec)) {
+			bignum_free(ret);
+			return NULL;
+		}
+	}
+	return ret;
+}
+
+/*
+ * Exponential and logarithm.
+ * e ^ x is summed as a Taylor series by binary splitting, after x is
+ * halved s times down to below 2^-8 and before the sum is squared back
+ * s times. The digits of the reduced x are split at 1, 2, 4, 8, ...
+ * digits after point, and exp of each part is summed separately: the
+ * part of digits (lo, hi] is an integer p over RADIX^hi, with p of
+ * hi - lo digits and terms falling by RADIX^lo each, so that every sum
+ * needs few terms of small numbers or few terms of few digits (the
+ * bit-burst method). log a is found by Newton's iteration on exp,
+ * y += a / e ^ y - 1, doubling the digits computed at every step.
+ * Results are computed to EXP_GUARD more digits than asked for.
+ */
+
+#define LOG2_10 3.321928094887362
+#define LN2 0.6931471805599453
+// log RADIX
+#define LN_RADIX (RNUM * LOG2_10 * LN2)
+// exponents of e past which results have more digits than an int can count
+#define EXP_MAX ((double)(1 << 30) * LN_RADIX)
+// extra bignum digits of exp and log, at least 20 decimal digits
+#define EXP_GUARD ((20 + RNUM - 1) / RNUM)
+
+/*
+ * Multiply num by RADIX^k, k >= 0.
+ */
+static void shift_up(struct bignum *num, int k) {
+	int n = num->num_digits;
+	bignum_resize(num, n + k);
+	memmove(num->digits + k, num->digits, n * sizeof(digit_t));
+	memset(num->digits, 0, k * sizeof(digit_t));
+}
+
+/*
+ * Divide num by RADIX^k, k >= 0, moving the point.
+ */
+static void shift_down(struct bignum *num, int k) {
+	int n = num->num_digits;
+	num->point_offset += k;
+	if (n <= num->point_offset) {
+		bignum_resize(num, num->point_offset + 1);
+		memset(num->digits + n, 0, (num->num_digits - n) * sizeof(digit_t));
+	}
+}
+
+/*
+ * num = v >= 0, with `frac' digits after point.
+ */
+static void double_set(struct bignum *num, double v, int frac) {
+	unsigned long long i = (unsigned long long)v;
+	int_set(num, i);
+	shift_up(num, frac);
+	num->point_offset = frac;
+	v -= i;
+	for (int k = frac - 1; k >= 0; --k) {
+		v *= RADIX;
+		digit_t d = (digit_t)v;
+		num->digits[k] = d;
+		v -= d;
+	}
+}
+
+/*
+ * Return the leading digits of num, sign ignored, as v, with num about
+ * v * RADIX^e.
+ */
+static double lead_value(const struct bignum *num, int *e) {
+	int i = dig_len(num->digits, num->num_digits) - 1;
+	double v = 0;
+	for (; i >= 0 && v < 1e17; --i) v = v * RADIX + num->digits[i];
+	*e = i + 1 - num->point_offset;
+	return v;
+}
+
+/*
+ * Return num as a double, 0 if too small and huge if too large.
+ */
+static double approx_value(const struct bignum *num) {
+	int e;
+	double v = lead_value(num, &e);
+	for (; e > 0 && v < 1e300; --e) v *= RADIX;
+	for (; e < 0 && v > 0; ++e) v /= RADIX;
+	return num->sign ? -v : v;
+}
+
+/*
+ * Return log2 |num| for num != 0, to about 20 bits after point.
+ */
+static double approx_log2(const struct bignum *num) {
+	int e;
+	double v = lead_value(num, &e);
+	return e * RNUM * LOG2_10 + log2_approx(v);
+}
+
+/*
+ * Binary splitting of the terms n1 <= k < n2 of the series of e ^ x - 1,
+ * x = p / RADIX^h: P = p^(n2 - n1), Q = n1 (n1 + 1) ... (n2 - 1), and
+ * the terms sum to T / (Q RADIX^(h (n2 - n1))) times the term n1 - 1.
+ * P is only formed if need_p.
+ */
+static void exp_split(struct bignum *P, struct bignum *Q, struct bignum *T,
+		const struct bignum *p, int h, int n1, int n2, int need_p) {
+	if (n2 - n1 == 1) {
+		if (need_p) bignum_copy_into(P, p);
+		int_set(Q, n1);
+		bignum_copy_into(T, p);
+		return;
+	}
+	int m = (n1 + n2) / 2;
+	struct bignum *P2 = bignum_new(), *Q2 = bignum_new(), *T2 = bignum_new();
+	exp_split(P, Q, T, p, h, n1, m, 1);
+	exp_split(P2, Q2, T2, p, h, m, n2, need_p);
+	// T = T Q2 RADIX^(h (n2 - m)) + P T2
+	mul_into(T, T, Q2);
+	shift_up(T, h * (n2 - m));
+	mul_into(T2, P, T2);
+	addsub_into(T, T, T2, 0);
+	trim_leading(T);
+	mul_into(Q, Q, Q2);
+	trim_leading(Q);
+	if (need_p) {
+		mul_into(P, P, P2);
+		trim_leading(P);
+	}
+	bignum_free(P2);
+	bignum_free(Q2);
+	bignum_free(T2);
+}
+
+/*
+ * dst = e ^ y for |y| < 2^-8, to `prec' digits after point.
+ */
+static void exp_series(struct bignum *dst, const struct bignum *y, int prec) {
+	int_set(dst, 1);
+	struct bignum *p = bignum_new(), *P = bignum_new(), *Q = bignum_new();
+	struct bignum *T = bignum_new(), *one = bignum_new();
+	int_set(one, 1);
+	double target = (prec + 1) * RNUM * LOG2_10 + 2; // bits of the sums
+	int lim = min(y->point_offset, prec + 1);
+	for (int lo = 0, hi = 1; lo < lim; lo = hi, hi *= 2) {
+		if (hi > lim) hi = lim;
+		bignum_resize(p, hi - lo);
+		memcpy(p->digits, y->digits + y->point_offset - hi, (hi - lo) * sizeof(digit_t));
+		p->sign = y->sign;
+		p->point_offset = 0;
+		if (!dig_len(p->digits, p->num_digits)) continue;
+		// terms 1..n, with the term k below 2^-(k bits - log2 k!)
+		double bits = lo ? lo * RNUM * LOG2_10 : 8;
+		int n = 1;
+		for (double sum = bits; sum < target; sum += bits + log2_approx(n)) ++n;
+		exp_split(P, Q, T, p, hi, 1, n + 1, 0);
+		shift_down(T, hi * n);
+		div_into(T, T, Q, prec + 1);
+		addsub_into(T, T, one, 0);
+		mul_into(dst, dst, T);
+		trim_into(dst, prec + 1);
+		trim_leading(dst);
+	}
+	trim_into(dst, prec);
+	bignum_free(p);
+	bignum_free(P);
+	bignum_free(Q);
+	bignum_free(T);
+	bignum_free(one);
+}
+
+/*
+ * dst = e ^ x, to `prec' digits after point, with an error of a few units
+ * of the last. dst may alias x.
+ * Return -1, leaving dst unchanged, if e ^ x has more digits than an int
+ * can count, else 0.
+ */
+static int exp_into(struct bignum *dst, const struct bignum *x, int prec) {
+	double xv = approx_value(x);
+	if (xv > EXP_MAX) return -1;
+	if (xv < -(prec + 1) * LN_RADIX) {
+		// below a unit of the last digit
+		bignum_resize(dst, prec + 1);
+		memset(dst->digits, 0, dst->num_digits * sizeof(digit_t));
+		dst->sign = 0;
+		dst->point_offset = prec;
+		return 0;
+	}
+	int s = 0; // halvings of x
+	for (double m = xv < 0 ? -xv : xv; m >= 1.0 / 512; m /= 2) ++s;
+	// digits before point, and lost to the rounding of the squarings
+	int d = xv > 0 ? (int)(xv / LN_RADIX) + 1 : 0;
+	int w = prec + d + (int)(s / (RNUM * LOG2_10)) + 2;
+	struct bignum *y = bignum_new();
+	int_set(y, 1ULL << s);
+	div_into(y, x, y, w);
+	exp_series(dst, y, w);
+	for (int i = 0; i < s; ++i) {
+		mul_into(dst, dst, dst);
+		trim_into(dst, w);
+		trim_leading(dst);
+	}
+	trim_into(dst, prec);
+	bignum_free(y);
+	return 0;
+}
+
+/*
+ * dst = log a for a > 0, to `prec' digits after point, with an error of
+ * a few units of the last.
+ */
+static void log_into(struct bignum *dst, const struct bignum *a, int prec) {
+	struct bignum *one = bignum_new();
+	int_set(one, 1);
+	if (mag_comp(a, one) < 0) {
+		// log a = -log (1 / a), with 1 / a > 1 to as many digits
+		struct bignum *inv = bignum_new();
+		div_into(inv, one, a, prec + 1);
+		log_into(dst, inv, prec);
+		dst->sign = dig_len(dst->digits, dst->num_digits) != 0;
+		bignum_free(inv);
+		bignum_free(one);
+		return;
+	}
+	// about 5 decimal digits after point to start from
+	struct bignum *y = bignum_new(), *t = bignum_new();
+	double l = approx_log2(a) * LN2;
+	double_set(y, l > 0 ? l : 0, (5 + RNUM - 1) / RNUM + 1);
+	int goal = (prec + 1) * RNUM; // decimal digits after point
+	for (int correct = 5; correct < goal;) {
+		correct = min(2 * correct - 2, goal);
+		int w = (correct + RNUM - 1) / RNUM + 1;
+		exp_into(t, y, w);
+		div_into(t, a, t, w);
+		addsub_into(y, y, t, 0);
+		addsub_into(y, y, one, 1);
+		trim_into(y, w);
+		trim_leading(y);
+	}
+	bignum_copy_into(dst, y);
+	trim_into(dst, prec);
+	bignum_free(y);
+	bignum_free(t);
+	bignum_free(one);
+}
+
+/*
+ * Truncate num, computed to `prec' + EXP_GUARD digits after point, to
+ * `prec' digits, after raising its magnitude by a unit of the digit
+ * halfway through the guard. Exact results, as often computed just below
+ * a digit boundary, then come out exact.
+ */
+static void exp_round(struct bignum *num, int prec) {
+	int pos = prec + (EXP_GUARD + 1) / 2;
+	struct bignum *unit = bignum_alloc(pos + 1);
+	unit->digits[0] = 1;
+	unit->point_offset = pos;
+	unit->sign = num->sign;
+	addsub_into(num, num, unit, 0);
+	trim_into(num, prec);
+	normalize(num);
+	bignum_free(unit);
+}
+
+/*
+ * Return e ^ a, to the precision.
+ * Return NULL if the result has more digits than an int can count.
+ */
+struct bignum *bignum_exp(const struct bignum *a) {
+	int prec = precision_digits();
+	struct bignum *ret = bignum_new();
+	if (exp_into(ret, a, prec + EXP_GUARD)) {
+		bignum_free(ret);
+		return NULL;
+	}
+	exp_round(ret, prec);
+	return ret;
+}
+
+/*
+ * Return log a (natural), to the precision.
+ * Return NULL if a <= 0.
+ */
+struct bignum *bignum_log(const struct bignum *a) {
+	if (a->sign || !dig_len(a->digits, a->num_digits)) return NULL;
+	int prec = precision_digits();
+	struct bignum *ret = bignum_new();
+	log_into(ret, a, prec + EXP_GUARD);
+	exp_round(ret, prec);
+	return ret;
+}
+
+/*
+ * Raise a >= 0 to fractional powers as e ^ (b log a).
+ * Return a ^ b to `prec' bignum digits of precision.
+ * Return NULL if a = 0 and b < 0, or if a ^ b has more digits than an
+ * int can count.
+ */
+static struct bignum *pow_frac(const struct bignum *a, const struct bignum *b, int prec) {
+	if (!dig_len(a->digits, a->num_digits)) return b->sign ? NULL : bignum_new();
+	double bv = approx_value(b), bm = bv < 0 ? -bv : bv;
+	double z = bv * approx_log2(a) * LN2; // about b log a
+	if (z > EXP_MAX) return NULL;
+	struct bignum *ret = bignum_new();
+	// b log a is needed to as many digits as e ^ (b log a) has before
+	// point more, and log a to as many as b has before point more still
+	int w = prec + EXP_GUARD + 1 + (z > 0 ? (int)(z / LN_RADIX) + 1 : 0);
+	int wb = bm > 1 ? (int)(log2_approx(bm) / (RNUM * LOG2_10)) + 1 : 0;
+	struct bignum *l = bignum_new();
+	log_into(l, a, w + wb);
+	mul_into(l, l, b);
+	trim_into(l, w);
+	int err = exp_into(ret, l, prec + EXP_GUARD);
+	bignum_free(l);
+	if (err) {
+		bignum_free(ret);
+		return NULL;
+	}
+	exp_round(ret, prec);
+	return ret;
+}
+
+// extra bignum digits carried by pow to absorb the rounding of its steps
+#define POW_GUARD 1
+
+/*
+ * Raise to arbitrary bignum powers.
+ * Integer exponents (with any digits after point zero) are computed
+ * exactly, but for the division of negative ones, and fractional
+ * exponents as e ^ (b log a), both to the precision.
+ *
+ * Return NULL if a is negative and b has fractional part, if a = 0 and
+ * b < 0, or if a fractional power has more digits than an int can count.
+ */
+struct bignum *long_pow(const struct bignum *a, const struct bignum *b) {
+	STAT_BEGIN(BIGNUM_STAT_POW, a->num_digits + b->num_digits);
+	int prec = precision_digits();
+	struct bignum *ret;
+	if (dig_len(b->digits, b->point_offset)) {
+		ret = a->sign && dig_len(a->digits, a->num_digits) ? NULL : pow_frac(a, b, prec);
+	} else {
+		struct bignum *c = trim_fraction(b, 0); // the integer b
+		ret = pow_sint(a, c, prec + POW_GUARD);
+		bignum_free(c);
+		if (ret) {
+			trim_into(ret, prec);
+			normalize(ret);
+		}
+	}
+	STAT_END();
+	return ret;
+}
+
+/*
+ * Modular arithmetic on integers.
+ * A context holds a modulus m of n digits and its Barrett reciprocal
+ * x = floor(R^2n / m), computed once by Newton iteration. Reductions
+ * then take two multiplications and at most two subtractions, with no
+ * trial division. Contexts are read only once made, so threads may
+ * share them; they are always on the heap, outside any arena.
+ * Operands must be integers (any digits after point must be zero).
+ * Results are in [0, m).
+ */
+struct bignum_mod_ctx {
+	int n; // digits of m
+	int xn; // digits of x
+	digit_t *m;
+	digit_t *x;
+};
+
+/*
+ * Return the number of digits before point of a without leading zeroes,
+ * or -1 if a has a nonzero digit after point.
+ */
+static int int_len(const struct bignum *a) {
+	if (dig_len(a->digits, a->point_offset)) return -1;
+	return dig_len(a->digits + a->point_offset, a->num_digits - a->point_offset);
+}
+
+/*
+ * Return a context for the modulus m, or NULL if m is not a positive
+ * integer. Free it with bignum_mod_ctx_free.
+ */
+struct bignum_mod_ctx *bignum_mod_ctx_new(const struct bignum *m) {
+	int n = int_len(m);
+	if (n <= 0 || m->sign) return NULL;
+	struct bignum_mod_ctx *ctx = malloc(sizeof(struct bignum_mod_ctx));
+	digit_t *d = malloc((2 * n + 2) * sizeof(digit_t));
+	if (!ctx || !d) exit(EXIT_FAILURE);
+	ctx->n = n;
+	ctx->m = d;
+	ctx->x = d + n;
+	memcpy(ctx->m, m->digits + m->point_offset, n * sizeof(digit_t));
+	dig_recip(ctx->x, ctx->m, n);
+	ctx->xn = dig_len(ctx->x, n + 2);
+	return ctx;
+}
+
+void bignum_mod_ctx_free(struct bignum_mod_ctx *ctx) {
+	if (!ctx) return;
+	free(ctx->m);
+	free(ctx);
+}
+
+// scratch digits needed by mod_step and mod_reduce
+#define MOD_STEP_SCRATCH(n) (4 * (n) + 3)
+#define MOD_SCRATCH(n) (6 * (n) + 3)
+
+/*
+ * num[0..2n) = num mod m, for num < m R^n, so that the remainder is in
+ * num[0..n) and num[n..2n) is zero. Barrett's method (HAC 14.42).
+ * t is scratch space of MOD_STEP_SCRATCH(n) digits.
+ */
+static void mod_step(const struct bignum_mod_ctx *ctx, digit_t *num, digit_t *t) {
+	int n = ctx->n;
+	digit_t *qx = t, *p = t + 2 * n + 3;
+	// q3 = floor(floor(num / R^(n - 1)) * x / R^(n + 1)), within 2 of num / m
+	int q1n = dig_len(num + n - 1, n + 1);
+	memset(qx, 0, (2 * n + 3) * sizeof(digit_t));
+	if (q1n) dig_mul(qx, num + n - 1, q1n, ctx->x, ctx->xn);
+	digit_t *q3 = qx + n + 1; // at most n digits since q3 <= num / m < R^n
+	int q3n = dig_len(q3, n);
+	if (q3n) {
+		dig_mul(p, q3, q3n, ctx->m, n);
+		dig_sub_into(num, 2 * n, p, q3n + n);
+	}
+	while (dig_len(num + n, n) || dig_cmp(num, ctx->m, n) >= 0) dig_sub_into(num, 2 * n, ctx->m, n);
+}
+
+/*
+ * r[0..n) = u[0..un) mod m.
+ * u is reduced from the top, n digits at a time.
+ * t is scratch space of MOD_SCRATCH(n) digits.
+ */
+static void mod_reduce(const struct bignum_mod_ctx *ctx, digit_t *r, const digit_t *u, int un, digit_t *t) {
+	int n = ctx->n;
+	digit_t *num = t; // remainder so far R^n + block
+	memset(num, 0, 2 * n * sizeof(digit_t));
+	for (int j = (un + n - 1) / n - 1; j >= 0; --j) {
+		memcpy(num + n, num, n * sizeof(digit_t));
+		memset(num, 0, n * sizeof(digit_t));
+		memcpy(num, u + j * n, min(n, un - j * n) * sizeof(digit_t));
+		mod_step(ctx, num, t + 2 * n);
+	}
+	memcpy(r, num, n * sizeof(digit_t));
+}
+
+/*
+ * r[0..n) = a mod m. Return 0, or -1 if a is not an integer.
+ * t is scratch space of MOD_SCRATCH(n) digits.
+ */
+static int mod_residue(const struct bignum_mod_ctx *ctx, digit_t *r, const struct bignum *a, digit_t *t) {
+	int an = int_len(a);
+	if (an < 0) return -1;
+	mod_reduce(ctx, r, a->digits + a->point_offset, an, t);
+	if (a->sign && dig_len(r, ctx->n)) dig_sub(r, ctx->m, ctx->n, r, ctx->n);
+	return 0;
+}
+
+/*
+ * dst = r[0..n) as an integer.
+ */
+static void mod_store(struct bignum *dst, const digit_t *r, int n) {
+	bignum_resize(dst, n);
+	memcpy(dst->digits, r, n * sizeof(digit_t));
+	dst->sign = 0;
+	dst->point_offset = 0;
+	normalize(dst);
+}
+
+/*
+ * dst = a mod m, reusing the digits of dst. dst may alias a.
+ * Return 0, or -1 if a is not an integer, leaving dst unchanged.
+ */
+int bignum_mod(struct bignum *dst, const struct bignum *a, const struct bignum_mod_ctx *ctx) {
+	int n = ctx->n;
+	digit_t *r = malloc((n + MOD_SCRATCH(n)) * sizeof(digit_t));
+	if (!r) exit(EXIT_FAILURE);
+	int ret = mod_residue(ctx, r, a, r + n);
+	if (!ret) mod_store(dst, r, n);
+	free(r);
+	return ret;
+}
+
+/*
+ * dst = a * b mod m, reusing the digits of dst. dst may alias a or b.
+ * Return 0, or -1 if a or b is not an integer, leaving dst unchanged.
+ */
+int bignum_mulmod(struct bignum *dst, const struct bignum *a, const struct bignum *b,
+		const struct bignum_mod_ctx *ctx) {
+	int n = ctx->n;
+	digit_t *ra = malloc((4 * n + MOD_SCRATCH(n)) * sizeof(digit_t));
+	if (!ra) exit(EXIT_FAILURE);
+	digit_t *rb = ra + n, *p = rb + n, *t = p + 2 * n;
+	int ret = mod_residue(ctx, ra, a, t);
+	if (!ret && b != a) ret = mod_residue(ctx, rb, b, t);
+	if (!ret) {
+		// squares are passed as such to the kernels
+		dig_mul(p, ra, n, b != a ? rb : ra, n);
+		mod_step(ctx, p, t);
+		mod_store(dst, p, n);
+	}
+	free(ra);
+	return ret;
+}
+
+/*
+ * dst = a ^ e mod m, reusing the digits of dst. dst may alias a or e.
+ * Sliding window exponentiation as in pow_uint, reducing after every
+ * product, so no intermediate exceeds 2n digits.
+ * Return 0, or -1 if a or e is not an integer or e < 0, leaving dst
+ * unchanged.
+ */
+int bignum_powmod(struct bignum *dst, const struct bignum *a, const struct bignum *e,
+		const struct bignum_mod_ctx *ctx) {
+	int n = ctx->n;
+	int en = int_len(e);
+	if (en < 0 || (en && e->sign)) return -1;
+	int nbits = 0;
+	char *bits = en ? exp_bits(e->digits + e->point_offset, en, &nbits) : NULL;
+	int k = pow_window(nbits);
+	int npow = 1 << (k - 1);
+	// odd powers, a^2, the result and a product
+	digit_t *pw = malloc(((npow + 2) * n + 2 * n + MOD_SCRATCH(n)) * sizeof(digit_t));
+	if (!pw) exit(EXIT_FAILURE);
+	digit_t *a2 = pw + npow * n, *res = a2 + n, *p = res + n, *t = p + 2 * n;
+	if (mod_residue(ctx, pw, a, t)) {
+		free(bits);
+		free(pw);
+		return -1;
+	}
+	if (npow > 1) {
+		dig_mul(p, pw, n, pw, n);
+		mod_step(ctx, p, t);
+		memcpy(a2, p, n * sizeof(digit_t));
+		for (int i = 1; i < npow; ++i) {
+			dig_mul(p, pw + (i - 1) * n, n, a2, n);
+			mod_step(ctx, p, t);
+			memcpy(pw + i * n, p, n * sizeof(digit_t));
+		}
+	}
+	// a^0 = 1 mod m
+	digit_t one = 1;
+	mod_reduce(ctx, res, &one, 1, t);
+	int first = 1;
+	for (int i = nbits - 1; i >= 0;) {
+		if (!bits[i]) {
+			dig_mul(p, res, n, res, n);
+			mod_step(ctx, p, t);
+			memcpy(res, p, n * sizeof(digit_t));
+			--i;
+			continue;
+		}
+		// the longest window bits[j..i] of at most k bits with bits[j] set
+		int j = i - k + 1 > 0 ? i - k + 1 : 0;
+		while (!bits[j]) ++j;
+		int w = 0;
+		for (int b = i; b >= j; --b) w = 2 * w + bits[b];
+		if (first) {
+			memcpy(res, pw + w / 2 * n, n * sizeof(digit_t));
+			first = 0;
+		} else {
+			for (int b = i; b >= j; --b) {
+				dig_mul(p, res, n, res, n);
+				mod_step(ctx, p, t);
+				memcpy(res, p, n * sizeof(digit_t));
+			}
+			dig_mul(p, res, n, pw + w / 2 * n, n);
+			mod_step(ctx, p, t);
+			memcpy(res, p, n * sizeof(digit_t));
+		}
+		i = j - 1;
+	}
+	mod_store(dst, res, n);
+	free(bits);
+	free(pw);
+	return 0;
+}
 #if 0
 int main() {
 	while (1) {
@@ -1,18 +1,79 @@
 #ifndef BIGNUM_H
 #define BIGNUM_H
 
+#include <stddef.h>
+#include <stdio.h>
+
 struct bignum;
 
 void bignum_free(struct bignum*);
 struct bignum *clone(const struct bignum*);
 struct bignum *bignum_abs(const struct bignum*);
 struct bignum *string_to_bignum(const char*);
+struct bignum *string_to_bignum_n(const char*, size_t);
 char *bignum_to_string(const struct bignum*);
+size_t bignum_to_chars(const struct bignum*, char*, size_t);
+int bignum_write(FILE*, const struct bignum*);
+size_t bignum_serialize(const struct bignum*, void*, size_t);
+struct bignum *bignum_deserialize(const void*, size_t, size_t*);
 int mag_comp(const struct bignum*, const struct bignum*);
 struct bignum *addsub_signed(const struct bignum*, const struct bignum*, int);
 struct bignum *long_mul(const struct bignum*, const struct bignum*);
 struct bignum *long_div(const struct bignum*, const struct bignum*);
 struct bignum *sqrt_signed(const struct bignum*);
 struct bignum *long_pow(const struct bignum*, const struct bignum*);
+struct bignum *bignum_exp(const struct bignum*);
+struct bignum *bignum_log(const struct bignum*);
+
+/* per thread precision in decimal digits after point, default 20; results
+ * keep no more bignum digits after point than it takes, see bignum.c */
+int bignum_set_precision(int);
+int bignum_get_precision(void);
+
+/* threads for multiplications of at least min_digits decimal digits, see bignum.c */
+int bignum_set_threads(int, int);
+
+/* in-place API: results go to the first argument, which may alias the others */
+struct bignum *bignum_new(void);
+void bignum_copy_into(struct bignum*, const struct bignum*);
+void bignum_add_into(struct bignum*, const struct bignum*, const struct bignum*);
+void bignum_sub_into(struct bignum*, const struct bignum*, const struct bignum*);
+void bignum_mul_into(struct bignum*, const struct bignum*, const struct bignum*);
+void bignum_sqr_into(struct bignum*, const struct bignum*);
+int bignum_div_into(struct bignum*, const struct bignum*, const struct bignum*);
+
+/* machine word operands, in place as above, see bignum.c */
+void bignum_add_ui(struct bignum*, const struct bignum*, unsigned long);
+void bignum_mul_ui(struct bignum*, const struct bignum*, unsigned long);
+int bignum_div_ui(struct bignum*, const struct bignum*, unsigned long);
+int bignum_cmp_ui(const struct bignum*, unsigned long);
+
+/* per operation statistics of builds with -DBIGNUM_STATS, see bignum.c */
+enum {
+	BIGNUM_STAT_PARSE, BIGNUM_STAT_FORMAT, BIGNUM_STAT_ADD, BIGNUM_STAT_SUB,
+	BIGNUM_STAT_MUL, BIGNUM_STAT_DIV, BIGNUM_STAT_SQRT, BIGNUM_STAT_POW,
+	BIGNUM_STAT_OPS
+};
+struct bignum_stats {
+	unsigned long long calls;
+	unsigned long long limbs; /* bignum digits of the operands */
+	unsigned long long allocs; /* heap allocations for bignums */
+	unsigned long long bytes; /* bytes of those allocations */
+	unsigned long long ns; /* time, including nested operations */
+};
+int bignum_stats_get(struct bignum_stats*);
+void bignum_stats_reset(void);
+
+/* integers modulo m, with a context made once per modulus, see bignum.c */
+struct bignum_mod_ctx;
+struct bignum_mod_ctx *bignum_mod_ctx_new(const struct bignum*);
+void bignum_mod_ctx_free(struct bignum_mod_ctx*);
+int bignum_mod(struct bignum*, const struct bignum*, const struct bignum_mod_ctx*);
+int bignum_mulmod(struct bignum*, const struct bignum*, const struct bignum*, const struct bignum_mod_ctx*);
+int bignum_powmod(struct bignum*, const struct bignum*, const struct bignum*, const struct bignum_mod_ctx*);
+
+/* per thread arena scopes, see bignum.c */
+int bignum_arena_begin(void);
+void bignum_arena_end(void);
 
 #endif
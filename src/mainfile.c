@@ -1,113 +1,699 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "bignum.h"
 
-// buffersize for bignum strings
-#define BF 10010
-
-void badd() {
-	char sa[BF], sb[BF];
-	scanf("%s %s", sa, sb);
-	struct bignum *a = string_to_bignum(sa);
-	struct bignum *b = string_to_bignum(sb);
-	struct bignum *r = addsub_signed(a, b, 0);
-	printf("%s\n", bignum_to_string(r));
-	bignum_free(a);
-	bignum_free(b);
-	bignum_free(r);
-}
-
-void bsub() {
-	char sa[BF], sb[BF];
-	scanf("%s %s", sa, sb);
-	struct bignum *a = string_to_bignum(sa);
-	struct bignum *b = string_to_bignum(sb);
-	struct bignum *r = addsub_signed(a, b, 1);
-	printf("%s\n", bignum_to_string(r));
-	bignum_free(a);
-	bignum_free(b);
-	bignum_free(r);
-}
-
-void bmul() {
-	char sa[BF], sb[BF];
-	scanf("%s %s", sa, sb);
-	struct bignum *a = string_to_bignum(sa);
-	struct bignum *b = string_to_bignum(sb);
-	struct bignum *r = long_mul(a, b);
-	printf("%s\n", bignum_to_string(r));
-	bignum_free(a);
-	bignum_free(b);
-	bignum_free(r);
-}
-
-void bdiv() {
-	char sa[BF], sb[BF];
-	scanf("%s %s", sa, sb);
-	struct bignum *a = string_to_bignum(sa);
-	struct bignum *b = string_to_bignum(sb);
-	struct bignum *r = long_div(a, b);
-	if (r == NULL) {
-		printf("Division by zero error!\n");
-	} else {
-		printf("%s\n", bignum_to_string(r));
-		bignum_free(r);
+/*
+ * The whole input as one array of chars.
+ * Regular files are memory mapped, other files are read in large chunks.
+ * Operands are parsed in place, so their length is not limited.
+ */
+struct input {
+	const char *data;
+	size_t size;
+	size_t pos; // where the next token is searched from
+	int mapped;
+};
+
+// size of the chunks in which unmappable input is read
+#define READ_CHUNK (1 << 20)
+
+/*
+ * Open the file at `path' as input. Exit with failure on error.
+ */
+static void input_open(struct input *in, const char *path) {
+	in->pos = 0;
+	in->mapped = 0;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		perror(path);
+		exit(EXIT_FAILURE);
 	}
-	bignum_free(a);
-	bignum_free(b);
+	struct stat st;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED) {
+			madvise(data, st.st_size, MADV_SEQUENTIAL);
+			in->data = data;
+			in->size = st.st_size;
+			in->mapped = 1;
+			close(fd);
+			return;
+		}
+	}
+	char *buf = NULL;
+	size_t size = 0, cap = 0;
+	for (;;) {
+		if (cap - size < READ_CHUNK) {
+			cap = cap ? 2 * cap : READ_CHUNK;
+			buf = realloc(buf, cap);
+			if (!buf) exit(EXIT_FAILURE);
+		}
+		ssize_t n = read(fd, buf + size, cap - size);
+		if (n < 0) {
+			perror(path);
+			exit(EXIT_FAILURE);
+		}
+		if (n == 0) break;
+		size += n;
+	}
+	close(fd);
+	in->data = buf;
+	in->size = size;
 }
 
-void bsqrt() {
-	char sa[BF];
-	scanf("%s", sa);
-	struct bignum *a = string_to_bignum(sa);
-	struct bignum *r = sqrt_signed(a);
-	if (r == NULL) {
-		printf("Sqrt of negative number not supported!\n");
-	} else {
-		printf("%s\n", bignum_to_string(r));
-		bignum_free(r);
-	}
-	bignum_free(a);
-}
-
-void babs() {
-	char sa[BF];
-	scanf("%s", sa);
-	struct bignum *a = string_to_bignum(sa);
-	struct bignum *r = bignum_abs(a);
-	printf("%s\n", bignum_to_string(r));
-	bignum_free(r);
-	bignum_free(a);
-}
-
-void bpow() {
-	char sa[BF], sb[BF];
-	scanf("%s %s", sa, sb);
-	struct bignum *a = string_to_bignum(sa);
-	struct bignum *b = string_to_bignum(sb);
-	struct bignum *r = long_pow(a, b);
-	if (r == NULL) {
-		printf("Fractional power of negative base not supported!\n");
+static void input_close(struct input *in) {
+	if (in->mapped) munmap((void *)in->data, in->size);
+	else free((void *)in->data);
+}
+
+/*
+ * A whitespace separated word of the input, not terminated.
+ */
+struct token {
+	const char *s;
+	size_t n; // 0 at the end of input
+};
+
+static struct token next_token(struct input *in) {
+	const char *data = in->data;
+	size_t i = in->pos;
+	while (i < in->size && isspace((unsigned char)data[i])) ++i;
+	size_t start = i;
+	while (i < in->size && !isspace((unsigned char)data[i])) ++i;
+	in->pos = i;
+	struct token t = {data + start, i - start};
+	return t;
+}
+
+/*
+ * Number of tokens left on the current line of the input, up to max.
+ */
+static int tokens_on_line(const struct input *in, int max) {
+	const char *data = in->data;
+	size_t i = in->pos;
+	int n = 0;
+	while (n < max) {
+		while (i < in->size && data[i] != '\n' && isspace((unsigned char)data[i])) ++i;
+		if (i == in->size || data[i] == '\n') break;
+		++n;
+		while (i < in->size && !isspace((unsigned char)data[i])) ++i;
+	}
+	return n;
+}
+
+/*
+ * Registers: bignums kept by name between operations, so that chained
+ * operations take their operands without printing and parsing them.
+ * Names start with a letter or '_', numbers never do. The values are
+ * on the heap, outside the arenas of the operations. Registers are only
+ * used by one thread at a time.
+ */
+struct reg {
+	char *name; // NULL for a free slot
+	size_t n;
+	struct bignum *val;
+	int set; // val was set by a statement
+};
+
+static struct reg *regs; // open addressing table
+static size_t regs_cap, nregs; // regs_cap is 0 or a power of 2
+
+static int is_name(struct token t) {
+	return t.n && (isalpha((unsigned char)t.s[0]) || t.s[0] == '_');
+}
+
+static size_t name_hash(const char *s, size_t n) {
+	size_t h = 14695981039346656037ULL; // FNV-1a
+	for (size_t i = 0; i < n; ++i) h = (h ^ (unsigned char)s[i]) * 1099511628211ULL;
+	return h;
+}
+
+/*
+ * Return the slot of register `name' in regs, possibly free.
+ */
+static struct reg *reg_slot(const char *name, size_t n) {
+	size_t i = name_hash(name, n) & (regs_cap - 1);
+	while (regs[i].name && (regs[i].n != n || memcmp(regs[i].name, name, n))) {
+		i = (i + 1) & (regs_cap - 1);
+	}
+	return &regs[i];
+}
+
+/*
+ * Return the value of register `name', NULL if it was never set.
+ */
+static struct bignum *reg_get(struct token name) {
+	if (!nregs) return NULL;
+	struct reg *r = reg_slot(name.s, name.n);
+	return r->set ? r->val : NULL;
+}
+
+/*
+ * Return register `name' to be set, its value made 0 and not yet set if
+ * it is new. Call outside arena scopes.
+ */
+static struct reg *reg_set(struct token name) {
+	if (2 * (nregs + 1) > regs_cap) {
+		// grow, keeping the table at most half full
+		struct reg *old = regs;
+		size_t old_cap = regs_cap;
+		regs_cap = regs_cap ? 2 * regs_cap : 64;
+		regs = calloc(regs_cap, sizeof(struct reg));
+		if (!regs) exit(EXIT_FAILURE);
+		for (size_t i = 0; i < old_cap; ++i) {
+			if (old[i].name) *reg_slot(old[i].name, old[i].n) = old[i];
+		}
+		free(old);
+	}
+	struct reg *r = reg_slot(name.s, name.n);
+	if (!r->name) {
+		r->name = malloc(name.n);
+		if (!r->name) exit(EXIT_FAILURE);
+		memcpy(r->name, name.s, name.n);
+		r->n = name.n;
+		r->val = bignum_new();
+		r->set = 0;
+		++nregs;
+	}
+	return r;
+}
+
+/*
+ * Records of the file given with -r, read as operands #0, #1, ...
+ */
+static struct input records;
+static size_t *record_pos; // offsets of the records
+static size_t nrecords;
+
+/*
+ * Map the records at `path' and find where each starts.
+ * Exit with failure on a bad record.
+ */
+static void records_open(const char *path) {
+	input_open(&records, path);
+	size_t cap = 0;
+	for (size_t pos = 0, used; pos < records.size; pos += used) {
+		bignum_arena_begin();
+		struct bignum *x = bignum_deserialize(records.data + pos, records.size - pos, &used);
+		bignum_arena_end();
+		if (!x) {
+			fprintf(stderr, "%s: bad record at byte %zu\n", path, pos);
+			exit(EXIT_FAILURE);
+		}
+		if (nrecords == cap) {
+			cap = cap ? 2 * cap : 1024;
+			record_pos = realloc(record_pos, cap * sizeof(size_t));
+			if (!record_pos) exit(EXIT_FAILURE);
+		}
+		record_pos[nrecords++] = pos;
+	}
+}
+
+/*
+ * Return record `t' (#k), read into the arena, NULL if there is none.
+ */
+static struct bignum *record_get(struct token t) {
+	size_t k = 0;
+	for (size_t i = 1; i < t.n; ++i) {
+		if (!isdigit((unsigned char)t.s[i]) || k > nrecords) return NULL;
+		k = 10 * k + (t.s[i] - '0');
+	}
+	if (t.n < 2 || k >= nrecords) return NULL;
+	size_t used;
+	return bignum_deserialize(records.data + record_pos[k], records.size - record_pos[k], &used);
+}
+
+static void regs_free(void) {
+	for (size_t i = 0; i < regs_cap; ++i) {
+		if (regs[i].name) {
+			free(regs[i].name);
+			bignum_free(regs[i].val);
+		}
+	}
+	free(regs);
+}
+
+/*
+ * Output of a statement: a line without '\n' or, with -w, a record of
+ * bignum_serialize. Failed statements give their message err, and with
+ * -w a record of 0 in its place.
+ */
+struct result {
+	char *data; // malloc'd, NULL if the result was stored in a register
+	size_t len;
+	const char *err;
+};
+
+static int binary_out; // -w
+
+/*
+ * Write res to stdout, which is fully buffered in large blocks.
+ * With -w, messages go to stderr with the number of the result.
+ */
+static void emit(struct result *res) {
+	static size_t count;
+	if (!res->data) return;
+	fwrite(res->data, 1, res->len, stdout);
+	if (!binary_out) putchar('\n');
+	else if (res->err) fprintf(stderr, "result %zu: %s\n", count, res->err);
+	++count;
+	free(res->data);
+}
+
+// size of the stdout buffer
+#define WRITE_BUFFER (1 << 20)
+
+enum { OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_SQRT, OP_ABS, OP_POW, OP_SET, OP_PRINT, OP_NONE };
+static const char *const OP_NAMES[] = {
+	"ADD", "SUB", "MUL", "DIV", "SQRT", "ABS", "POW", "SET", "PRINT"
+};
+
+/*
+ * Return the code of operation `op', OP_NONE if unknown.
+ */
+static int op_code(struct token op) {
+	for (int i = 0; i < OP_NONE; ++i) {
+		if (strlen(OP_NAMES[i]) == op.n && memcmp(op.s, OP_NAMES[i], op.n) == 0) return i;
+	}
+	return OP_NONE;
+}
+
+/*
+ * Number of operands taken by operation `code'.
+ */
+static int op_arity(int code) {
+	return code == OP_SQRT || code == OP_ABS || code == OP_SET || code == OP_PRINT ? 1 : 2;
+}
+
+/*
+ * An operation of the input: `OP a [b]' prints the result, `OP r a [b]',
+ * with r a register name, stores it in r instead.
+ */
+struct stmt {
+	int code;
+	struct token dst; // register of the result, empty if printed
+	struct token a, b; // point into the input, b empty for unary ops
+};
+
+/*
+ * Return the operand t, a register, a record or a number read into the
+ * arena. Return NULL for a register never set or a record not there.
+ */
+static const struct bignum *operand(struct token t) {
+	if (is_name(t)) return reg_get(t);
+	if (t.s[0] == '#') return record_get(t);
+	return string_to_bignum_n(t.s, t.n);
+}
+
+/*
+ * Return the message of POW failing on base a.
+ */
+static const char *pow_error(const struct bignum *a) {
+	int cmp = bignum_cmp_ui(a, 0);
+	if (!cmp) return "Division by zero error!";
+	if (cmp < 0) return "Fractional power of negative base not supported!";
+	return "Result too large!";
+}
+
+/*
+ * Evaluate statement st into res.
+ * Everything the operation allocates is released at once by the arena.
+ */
+static void eval(const struct stmt *st, struct result *res) {
+	int code = st->code;
+	// the register is made here, outside the arena, but its value only
+	// counts once the operands are read and the operation succeeds
+	struct reg *dst = st->dst.n ? reg_set(st->dst) : NULL;
+	bignum_arena_begin();
+	const struct bignum *a = operand(st->a);
+	const struct bignum *b = op_arity(code) == 2 ? operand(st->b) : NULL;
+	const struct bignum *r = NULL;
+	const char *err = NULL;
+	if (!a || (op_arity(code) == 2 && !b)) {
+		struct token t = a ? st->b : st->a;
+		err = is_name(t) ? "Undefined register!" : "No such record!";
+		code = OP_NONE;
+	}
+	switch (code) {
+	case OP_ADD:
+		r = addsub_signed(a, b, 0);
+		break;
+	case OP_SUB:
+		r = addsub_signed(a, b, 1);
+		break;
+	case OP_MUL:
+		r = long_mul(a, b);
+		break;
+	case OP_DIV:
+		r = long_div(a, b);
+		if (r == NULL) err = "Division by zero error!";
+		break;
+	case OP_SQRT:
+		r = sqrt_signed(a);
+		if (r == NULL) err = "Sqrt of negative number not supported!";
+		break;
+	case OP_ABS:
+		r = bignum_abs(a);
+		break;
+	case OP_POW:
+		r = long_pow(a, b);
+		if (r == NULL) err = pow_error(a);
+		break;
+	case OP_SET:
+	case OP_PRINT:
+		r = a;
+		break;
+	}
+	res->data = NULL;
+	res->err = r ? NULL : err;
+	if (dst && r) {
+		bignum_copy_into(dst->val, r);
+		dst->set = 1;
+	} else if (binary_out) {
+		if (!r) r = string_to_bignum("0");
+		res->len = bignum_serialize(r, NULL, 0);
+		res->data = malloc(res->len);
+		if (!res->data) exit(EXIT_FAILURE);
+		bignum_serialize(r, res->data, res->len);
 	} else {
-		printf("%s\n", bignum_to_string(r));
-		bignum_free(r);
+		res->data = r ? bignum_to_string(r) : strdup(err);
+		if (!res->data) exit(EXIT_FAILURE);
+		res->len = strlen(res->data);
+	}
+	bignum_arena_end();
+}
+
+/*
+ * Read the next statement from in into st.
+ * A register name followed by as many operands as the operation takes
+ * on the same line is the register of the result.
+ * Unknown operations are skipped.
+ * Return its operation, OP_NONE at the end of input.
+ */
+static int next_op(struct input *in, struct stmt *st) {
+	for (;;) {
+		struct token op = next_token(in);
+		if (!op.n) return OP_NONE;
+		int code = op_code(op);
+		if (code == OP_NONE) continue;
+		int arity = op_arity(code);
+		st->code = code;
+		st->dst.n = st->b.n = 0;
+		st->a = next_token(in);
+		if (is_name(st->a) && tokens_on_line(in, arity) == arity) {
+			st->dst = st->a;
+			st->a = next_token(in);
+		}
+		if (arity == 2) st->b = next_token(in);
+		if (!st->a.n || (arity == 2 && !st->b.n)) return OP_NONE; // truncated
+		return code;
+	}
+}
+
+/*
+ * Evaluate st and write its output if it has one.
+ */
+static void run_stmt(const struct stmt *st) {
+	struct result res;
+	eval(st, &res);
+	emit(&res);
+}
+
+/*
+ * Evaluate operations one at a time.
+ */
+static void run_serial(struct input *in) {
+	struct stmt st;
+	while (next_op(in, &st) != OP_NONE) run_stmt(&st);
+}
+
+/*
+ * Batch mode: operations are read in blocks of BATCH, evaluated by a pool
+ * of threads made once for the run and printed in input order.
+ * Each thread owns a range of the block and takes operations from its
+ * front. A thread whose range is empty steals the back half of the range
+ * of another thread, so that a few expensive operations do not leave
+ * the other threads idle.
+ * A statement that uses registers ends the block, and runs alone after
+ * it, so that registers are set and read in input order.
+ */
+#define BATCH 65536
+
+struct job {
+	struct stmt st;
+	struct result res;
+};
+
+struct range {
+	pthread_mutex_t lock;
+	int next, end; // jobs [next, end) are still to be done
+};
+
+struct worker_arg {
+	struct pool *pool;
+	int id;
+};
+
+/*
+ * Threads made once per run and handed a block at a time. Thread 0 is
+ * the calling thread.
+ */
+struct pool {
+	struct job *jobs;
+	struct range *ranges;
+	int nthreads;
+	pthread_t *threads;
+	struct worker_arg *args;
+	pthread_mutex_t lock;
+	pthread_cond_t start, done; // a block is handed out, all workers are done
+	unsigned long block; // number of blocks handed out
+	int running; // workers still on the current block
+	int quit;
+};
+
+/*
+ * Take the back half of the range of some other thread into range `id'.
+ * Return 0 if all ranges are empty.
+ */
+static int steal(struct pool *pool, int id) {
+	for (int k = 1; k < pool->nthreads; ++k) {
+		struct range *victim = &pool->ranges[(id + k) % pool->nthreads];
+		pthread_mutex_lock(&victim->lock);
+		int left = victim->end - victim->next;
+		int mid = victim->end - (left + 1) / 2;
+		int end = victim->end;
+		if (left > 0) victim->end = mid;
+		pthread_mutex_unlock(&victim->lock);
+		if (left > 0) {
+			struct range *own = &pool->ranges[id];
+			pthread_mutex_lock(&own->lock);
+			own->next = mid;
+			own->end = end;
+			pthread_mutex_unlock(&own->lock);
+			return 1;
+		}
 	}
-	bignum_free(a);
-	bignum_free(b);
+	return 0;
 }
 
+/*
+ * Evaluate jobs of the current block as thread `id' until none is left.
+ */
+static void work(struct pool *pool, int id) {
+	struct range *own = &pool->ranges[id];
+	for (;;) {
+		pthread_mutex_lock(&own->lock);
+		int i = own->next < own->end ? own->next++ : -1;
+		pthread_mutex_unlock(&own->lock);
+		if (i < 0) {
+			if (!steal(pool, id)) break;
+			continue;
+		}
+		struct job *job = &pool->jobs[i];
+		eval(&job->st, &job->res);
+	}
+}
+
+static void *worker(void *arg) {
+	struct pool *pool = ((struct worker_arg *)arg)->pool;
+	int id = ((struct worker_arg *)arg)->id;
+	unsigned long seen = 0; // blocks worked on
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while (pool->block == seen && !pool->quit) pthread_cond_wait(&pool->start, &pool->lock);
+		if (pool->quit) break;
+		seen = pool->block;
+		pthread_mutex_unlock(&pool->lock);
+		work(pool, id);
+		pthread_mutex_lock(&pool->lock);
+		if (!--pool->running) pthread_cond_signal(&pool->done);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+/*
+ * Start a pool of `nthreads' threads, counting the calling one.
+ */
+static void pool_start(struct pool *pool, int nthreads) {
+	pool->nthreads = nthreads;
+	pool->ranges = malloc(nthreads * sizeof(struct range));
+	pool->threads = malloc(nthreads * sizeof(pthread_t));
+	pool->args = malloc(nthreads * sizeof(struct worker_arg));
+	if (!pool->ranges || !pool->threads || !pool->args) exit(EXIT_FAILURE);
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->start, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	pool->block = 0;
+	pool->running = 0;
+	pool->quit = 0;
+	for (int t = 0; t < nthreads; ++t) {
+		pthread_mutex_init(&pool->ranges[t].lock, NULL);
+		pool->args[t].pool = pool;
+		pool->args[t].id = t;
+	}
+	for (int t = 1; t < nthreads; ++t) {
+		if (pthread_create(&pool->threads[t], NULL, worker, &pool->args[t])) exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ * Evaluate jobs[0..n) with the threads of the pool.
+ */
+static void pool_run(struct pool *pool, struct job *jobs, int n) {
+	if (n == 1) {
+		// no other thread could help
+		eval(&jobs[0].st, &jobs[0].res);
+		return;
+	}
+	int nthreads = pool->nthreads;
+	pool->jobs = jobs;
+	for (int t = 0; t < nthreads; ++t) {
+		pool->ranges[t].next = (long long)n * t / nthreads;
+		pool->ranges[t].end = (long long)n * (t + 1) / nthreads;
+	}
+	pthread_mutex_lock(&pool->lock);
+	pool->running = nthreads - 1;
+	++pool->block;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+	work(pool, 0);
+	pthread_mutex_lock(&pool->lock);
+	while (pool->running) pthread_cond_wait(&pool->done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * Stop the threads of the pool and free it.
+ */
+static void pool_stop(struct pool *pool) {
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = 1;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+	for (int t = 1; t < pool->nthreads; ++t) {
+		pthread_join(pool->threads[t], NULL);
+	}
+	for (int t = 0; t < pool->nthreads; ++t) {
+		pthread_mutex_destroy(&pool->ranges[t].lock);
+	}
+	pthread_cond_destroy(&pool->done);
+	pthread_cond_destroy(&pool->start);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->args);
+	free(pool->threads);
+	free(pool->ranges);
+}
+
+static void run_batch(struct input *in, int nthreads) {
+	struct job *jobs = malloc(BATCH * sizeof(struct job));
+	if (!jobs) exit(EXIT_FAILURE);
+	struct pool pool;
+	pool_start(&pool, nthreads);
+	int eof = 0;
+	while (!eof) {
+		int n = 0;
+		const struct stmt *serial = NULL; // ends the block
+		while (n < BATCH) {
+			struct stmt *st = &jobs[n].st;
+			if (next_op(in, st) == OP_NONE) {
+				eof = 1;
+				break;
+			}
+			if (st->dst.n || is_name(st->a) || is_name(st->b)) {
+				if (!n) {
+					// nothing is pending, so it runs at once
+					run_stmt(st);
+					continue;
+				}
+				serial = st;
+				break;
+			}
+			++n;
+		}
+		if (n) {
+			pool_run(&pool, jobs, n);
+			for (int i = 0; i < n; ++i) emit(&jobs[i].res);
+		}
+		if (serial) run_stmt(serial);
+	}
+	pool_stop(&pool);
+	free(jobs);
+}
+
+/*
+ * Usage: test [-j threads] [-r records] [-w] in out
+ * With -j, operations are evaluated in parallel, 0 threads meaning one
+ * per online processor.
+ * The input has one operation per line, `OP a [b]' or `OP r a [b]',
+ * where OP is one of OP_NAMES and the operands are numbers or register
+ * names. The first form prints the result, the second stores it in
+ * register r. `SET r a' sets r to a and `PRINT a' prints a.
+ * With -r, operand #k is the k-th number (from 0) of the file records,
+ * written by bignum_serialize. With -w, results are written to out as
+ * such records instead of lines.
+ */
 int main(int argc, char **argv) {
-	freopen(argv[1], "r", stdin);
-	freopen(argv[2], "w", stdout);
-	char op[10];
-	while (scanf("%s", op) != EOF) {
-		if (strcmp(op, "ADD") == 0) badd();
-		else if (strcmp(op, "SUB") == 0) bsub();
-		else if (strcmp(op, "MUL") == 0) bmul();
-		else if (strcmp(op, "DIV") == 0) bdiv();
-		else if (strcmp(op, "SQRT") == 0) bsqrt();
-		else if (strcmp(op, "ABS") == 0) babs();
-		else if (strcmp(op, "POW") == 0) bpow();
+	int nthreads = 0; // serial if 0
+	int argi = 1;
+	for (; argi < argc && argv[argi][0] == '-' && argv[argi][1]; ++argi) {
+		if (strcmp(argv[argi], "-j") == 0 && argi + 1 < argc) {
+			nthreads = atoi(argv[++argi]);
+			if (nthreads <= 0) nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+			if (nthreads <= 0) nthreads = 1;
+		} else if (strcmp(argv[argi], "-r") == 0 && argi + 1 < argc) {
+			records_open(argv[++argi]);
+		} else if (strcmp(argv[argi], "-w") == 0) {
+			binary_out = 1;
+		} else {
+			break;
+		}
+	}
+	if (argc != argi + 2) {
+		fprintf(stderr, "usage: %s [-j threads] [-r records] [-w] in out\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	struct input in;
+	input_open(&in, argv[argi]);
+	if (!freopen(argv[argi + 1], "w", stdout)) {
+		perror(argv[argi + 1]);
+		return EXIT_FAILURE;
+	}
+	setvbuf(stdout, NULL, _IOFBF, WRITE_BUFFER);
+	if (nthreads) run_batch(&in, nthreads);
+	else run_serial(&in);
+	input_close(&in);
+	if (records.data) {
+		input_close(&records);
+		free(record_pos);
 	}
+	regs_free();
+	return fclose(stdout) ? EXIT_FAILURE : 0;
 }